@@ -0,0 +1,218 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "defs.h"
+#include "layout.h"
+
+/* tilite-bench: drives the layout core through the recording backend, no X
+ * server involved. for each client count it reports time and configure
+ * requests per operation. */
+
+#define BENCH_SCR_W 1920
+#define BENCH_SCR_H 1080
+#define BENCH_GAPS 10
+#define BENCH_BW 1
+
+typedef struct {
+    const char *name;
+    uint64_t ns;
+    unsigned long ops;
+    unsigned long requests;
+} bench_op_t;
+
+enum {
+    OP_INSERT,
+    OP_LAYOUT,
+    OP_RELAYOUT,
+    OP_REGAP,
+    OP_NEIGHBOR,
+    OP_SWAP,
+    OP_MONOCLE,
+    OP_REMOVE,
+    OP_COUNT
+};
+
+static bench_op_t ops[OP_COUNT] = {
+    [OP_INSERT] = {"insert", 0, 0, 0},
+    [OP_LAYOUT] = {"layout", 0, 0, 0},
+    [OP_RELAYOUT] = {"relayout_same", 0, 0, 0},
+    [OP_REGAP] = {"relayout_gaps", 0, 0, 0},
+    [OP_NEIGHBOR] = {"find_neighbor", 0, 0, 0},
+    [OP_SWAP] = {"swap_leaves", 0, 0, 0},
+    [OP_MONOCLE] = {"monocle", 0, 0, 0},
+    [OP_REMOVE] = {"remove", 0, 0, 0},
+};
+
+static layout_rec_t rec;
+static layout_backend_t be;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static void account(int op, uint64_t start, unsigned long n) {
+    ops[op].ns += now_ns() - start;
+    ops[op].ops += n;
+    ops[op].requests += rec.requests;
+    layout_rec_reset(&rec);
+}
+
+static void run_once(client_t *clients, client_t **list, int n) {
+    bsp_node_t *root = NULL;
+    int x = BENCH_GAPS, y = BENCH_GAPS;
+    int w = BENCH_SCR_W - 2 * BENCH_GAPS, h = BENCH_SCR_H - 2 * BENCH_GAPS;
+
+    for (int i = 0; i < n; i++) {
+        clients[i] = (client_t){.win = 0x200000 + i, .mapped = True};
+        clients[i].next = i + 1 < n ? &clients[i + 1] : NULL;
+        list[i] = &clients[i];
+    }
+
+    /* same insertion order tile() uses when it rebuilds a tree */
+    uint64_t t = now_ns();
+    for (int i = 0; i < n; i++)
+        bsp_insert(&root, i > 0 ? list[i - 1] : NULL, list[i]);
+    account(OP_INSERT, t, n);
+
+    t = now_ns();
+    bsp_assign_rects(&be, root, x, y, w, h, BENCH_GAPS, BENCH_BW);
+    account(OP_LAYOUT, t, 1);
+
+    t = now_ns();
+    bsp_assign_rects(&be, root, x, y, w, h, BENCH_GAPS, BENCH_BW);
+    account(OP_RELAYOUT, t, 1);
+
+    t = now_ns();
+    bsp_assign_rects(&be, root, x, y, w, h, BENCH_GAPS + 1, BENCH_BW);
+    account(OP_REGAP, t, 1);
+
+    volatile client_t *sink = NULL;
+    t = now_ns();
+    for (int i = 0; i < n; i++)
+        sink = bsp_find_neighbor(clients, list[i], i & 3);
+    account(OP_NEIGHBOR, t, n);
+    (void)sink;
+
+    t = now_ns();
+    for (int i = 0; i + 1 < n; i += 2)
+        bsp_swap_leaves(root, list[i], list[n - 1 - i]);
+    account(OP_SWAP, t, MAX(1, n / 2));
+
+    /* tile_ws only sizes the window on top, the rest keep their geometry */
+    t = now_ns();
+    layout_monocle(&be, list, 1, x, y, w, h, BENCH_BW);
+    account(OP_MONOCLE, t, 1);
+
+    t = now_ns();
+    for (int i = 0; i < n; i++)
+        bsp_remove(&root, list[i]);
+    account(OP_REMOVE, t, n);
+
+    bsp_free(&root);
+}
+
+/* a relayout has to send every window that shrinks or only moves before
+ * any that grows, see bsp_assign_rects(). checked on a tree that loses one
+ * window while another one splits, so both kinds are sent */
+static Bool check_configure_order(void) {
+    enum { N = 16 };
+    client_t clients[N];
+    client_t *list[N];
+    int old_w[N], old_h[N];
+    bsp_node_t *root = NULL;
+    int x = BENCH_GAPS, y = BENCH_GAPS;
+    int w = BENCH_SCR_W - 2 * BENCH_GAPS, h = BENCH_SCR_H - 2 * BENCH_GAPS;
+
+    for (int i = 0; i < N; i++) {
+        clients[i] = (client_t){.win = i, .mapped = True};
+        list[i] = &clients[i];
+    }
+    for (int i = 0; i < N - 1; i++)
+        bsp_insert(&root, i > 0 ? list[i - 1] : NULL, list[i]);
+    bsp_assign_rects(&be, root, x, y, w, h, BENCH_GAPS, BENCH_BW);
+    for (int i = 0; i < N; i++) {
+        old_w[i] = clients[i].w;
+        old_h[i] = clients[i].h;
+    }
+    layout_rec_reset(&rec);
+
+    bsp_remove(&root, list[N / 4]);
+    bsp_insert(&root, list[N - 2], list[N - 1]);
+    bsp_assign_rects(&be, root, x, y, w, h, BENCH_GAPS, BENCH_BW);
+
+    int grown = 0, other = 0;
+    Bool ok = True;
+    for (size_t i = 0; i < rec.len; i++) {
+        layout_req_t *r = &rec.reqs[i];
+        if (r->w > old_w[r->win] || r->h > old_h[r->win]) {
+            grown++;
+        } else {
+            other++;
+            ok &= !grown;
+        }
+    }
+    layout_rec_reset(&rec);
+    bsp_free(&root);
+
+    if (!ok || !grown || !other)
+        fprintf(stderr,
+                "tilite-bench: relayout sent %d growing and %d other "
+                "configures, %s\n",
+                grown, other, ok ? "expected both" : "growing ones first");
+    return ok && grown && other;
+}
+
+static void bench(int n) {
+    client_t *clients = calloc(n, sizeof(client_t));
+    client_t **list = calloc(n, sizeof(client_t *));
+    if (!clients || !list) {
+        fprintf(stderr, "tilite-bench: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < OP_COUNT; i++)
+        ops[i].ns = ops[i].ops = ops[i].requests = 0;
+
+    /* enough rounds that small trees are not lost in clock noise */
+    int rounds = MAX(1, 20000 / n);
+    for (int r = 0; r < rounds; r++)
+        run_once(clients, list, n);
+
+    for (int i = 0; i < OP_COUNT; i++)
+        printf("%8d %-16s %14.1f %10.2f\n", n, ops[i].name,
+               (double)ops[i].ns / ops[i].ops,
+               (double)ops[i].requests / ops[i].ops);
+
+    free(clients);
+    free(list);
+}
+
+int main(int ac, char **av) {
+    static const int sizes[] = {10, 100, 1000, 10000};
+
+    be = layout_rec_backend(&rec);
+    if (!check_configure_order())
+        return EXIT_FAILURE;
+    printf("%8s %-16s %14s %10s\n", "clients", "op", "ns/op", "req/op");
+
+    if (ac > 1) {
+        for (int i = 1; i < ac; i++) {
+            int n = atoi(av[i]);
+            if (n < 1) {
+                fprintf(stderr, "usage: tilite-bench [clients ...]\n");
+                return EXIT_FAILURE;
+            }
+            bench(n);
+        }
+    } else {
+        for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+            bench(sizes[i]);
+    }
+
+    layout_rec_free(&rec);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,174 @@
+#include <poll.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+
+#include "defs.h"
+#include "mockx.h"
+
+/* tilite-check: runs the real handlers against the mock display in mockx.c
+ * through situations a recorded trace rarely covers, and checks the state
+ * they leave the windows in. prints each failed check and exits non-zero
+ * if there were any. */
+
+#define CHECK_ROOT 1
+#define CHECK_SCR_W 1920
+#define CHECK_SCR_H 1080
+
+static int failed = 0;
+
+static void check(Bool ok, const char *what) {
+    if (ok)
+        return;
+    fprintf(stderr, "tilite-check: %s\n", what);
+    failed++;
+}
+
+/* a client asks for w to be mapped, fullscreen if fs */
+static client_t *map(Window w, Bool fs) {
+    mock_window(w, CHECK_ROOT, 0, 0, 300, 200, 0, False, IsUnmapped);
+    if (fs) {
+        Atom a = atoms[ATOM_NET_WM_STATE_FULLSCREEN];
+        mock_prop_set(w, atoms[ATOM_NET_WM_STATE], XA_ATOM, 32, 1, &a);
+    }
+    XEvent ev = {.xmaprequest = {.type = MapRequest,
+                                 .parent = CHECK_ROOT,
+                                 .window = w}};
+    xev_case(&ev);
+    return find_client(w);
+}
+
+static Bool viewable(Window w) {
+    XWindowAttributes wa;
+    return XGetWindowAttributes(dpy, w, &wa) && wa.map_state == IsViewable;
+}
+
+static Bool state_hidden(Window w) {
+    Atom type, *v = NULL;
+    int format;
+    unsigned long n, after;
+    Bool found = False;
+    if (XGetWindowProperty(dpy, w, atoms[ATOM_NET_WM_STATE], 0, 32, False,
+                           XA_ATOM, &type, &format, &n, &after,
+                           (unsigned char **)&v) == Success) {
+        for (unsigned long i = 0; v && i < n && !found; i++)
+            found = v[i] == atoms[ATOM_NET_WM_STATE_HIDDEN];
+    }
+    XFree(v);
+    return found;
+}
+
+/* a covered window stays unmapped until the cover goes, then it shows */
+static void covered(client_t *c, const char *under) {
+    char what[128];
+    snprintf(what, sizeof(what), "window mapped under %s is viewable", under);
+    check(c && !viewable(c->win), what);
+    snprintf(what, sizeof(what), "window mapped under %s is not hidden",
+             under);
+    check(c && c->hidden == COVER_UNMAP && state_hidden(c->win), what);
+}
+
+static void uncovered(client_t *c, const char *from) {
+    char what[128];
+    snprintf(what, sizeof(what), "window is not back after %s", from);
+    check(c && viewable(c->win) && c->hidden == COVER_SHOW &&
+              !state_hidden(c->win),
+          what);
+}
+
+static void map_under_fullscreen(void) {
+    user_config.fullscreen_hide = COVER_UNMAP;
+    user_config.new_win_focus = True;
+    map(0x100, False);
+    client_t *fs = map(0x101, True);
+    check(fs && fs->fullscreen, "fullscreen request on map was ignored");
+
+    client_t *c = map(0x102, False);
+    covered(c, "a fullscreen window");
+    check(focused == fs, "window mapped under fullscreen took the focus");
+
+    /* a fullscreen client cannot move off its monitor or get a border */
+    XEvent ev = {.xconfigurerequest = {.type = ConfigureRequest,
+                                       .window = fs->win,
+                                       .x = 100,
+                                       .y = 100,
+                                       .width = 640,
+                                       .height = 480,
+                                       .border_width = 5,
+                                       .value_mask = CWX | CWY | CWWidth |
+                                                     CWHeight |
+                                                     CWBorderWidth}};
+    xev_case(&ev);
+    XWindowAttributes wa;
+    check(XGetWindowAttributes(dpy, fs->win, &wa) && wa.x == 0 &&
+              wa.y == 0 && wa.width == CHECK_SCR_W &&
+              wa.height == CHECK_SCR_H && wa.border_width == 0,
+          "fullscreen window left its monitor rect");
+
+    apply_fullscreen(fs, False);
+    uncovered(c, "fullscreen");
+}
+
+static void map_under_monocle(void) {
+    user_config.monocle_hide = COVER_UNMAP;
+    user_config.new_win_focus = False;
+    if (!monocle)
+        toggle_monocle();
+
+    client_t *c = map(0x103, False);
+    covered(c, "monocle");
+
+    toggle_monocle();
+    uncovered(c, "monocle");
+}
+
+/* a wrapper that forks the real program and exits 0 before that maps its
+ * window, the window still goes where the launch asked for */
+static void launch_through_wrapper(void) {
+    pipeline_t p = {.name = "wrapper"};
+    char *const *envp = launch_start(&p, 3);
+    const char *id = "";
+    for (int i = 0; envp[i]; i++)
+        if (strncmp(envp[i], "DESKTOP_STARTUP_ID=", 19) == 0)
+            id = envp[i] + 19;
+
+    char *argv[] = {"sh", "-c", "sleep 1 & exit 0", NULL};
+    pid_t pid;
+    int err = posix_spawnp(&pid, "sh", NULL, NULL, argv, envp);
+    launch_track(pid, err);
+
+    /* the wrapper is the only child, its exit is the first one reaped */
+    struct pollfd pfd;
+    check(launch_pollfd(&pfd) && poll(&pfd, 1, 2000) == 1,
+          "wrapper exit was not seen");
+    launch_dispatch(&pfd);
+
+    Window w = 0x104;
+    mock_window(w, CHECK_ROOT, 0, 0, 300, 200, 0, False, IsUnmapped);
+    mock_prop_set(w, atoms[ATOM_NET_STARTUP_ID], atoms[ATOM_UTF8_STRING], 8,
+                  strlen(id), id);
+    XEvent ev = {.xmaprequest = {.type = MapRequest,
+                                 .parent = CHECK_ROOT,
+                                 .window = w}};
+    xev_case(&ev);
+    client_t *c = find_client(w);
+    check(c && c->ws == 3,
+          "window of an exited wrapper missed its launch's workspace");
+}
+
+int main(void) {
+    mock_init(CHECK_ROOT, CHECK_SCR_W, CHECK_SCR_H);
+    setup();
+
+    map_under_fullscreen();
+    map_under_monocle();
+    launch_through_wrapper();
+
+    if (failed)
+        fprintf(stderr, "tilite-check: %d checks failed\n", failed);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
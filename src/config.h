@@ -18,14 +18,34 @@
 #define CFG_NEW_WIN_FOCUS True
 #define CFG_WARP_CURSOR True
 #define CFG_FLOATING_ON_TOP True
+/* windows under the monocle one: 0 leaves them, 1 marks them hidden so
+ * clients can stop drawing, 2 also unmaps them */
+#define CFG_MONOCLE_HIDE 1
+/* the same for tiled windows under a fullscreen one */
+#define CFG_FULLSCREEN_HIDE 1
+
+/* started all at once when tilite comes up, but not again on a restart.
+ * the number is the workspace the first window goes to, 0 for anywhere */
+#define CFG_AUTOSTART /* {"picom", 0}, {"firefox", 2}, */
+
+/* window rules. each one matches on any of .class, .instance, .title
+ * (anywhere in it) and .type (such as "dialog"), and its .action sets .ws
+ * (1-9), .floating, .fullscreen, .sticky, .no_focus or the floating .x, .y,
+ * .w and .h on its monitor. later rules win */
+#define CFG_RULES                                                              \
+    /* {.class = "mpv", .action = {.floating = True}},                         \
+       {.title = "Picture-in-Picture",                                         \
+        .action = {.sticky = True, .x = 1260, .y = 700, .w = 640, .h = 360}}, \
+     */
 
 #define CFG_BINDS                                                              \
     /* Application launchers */                                                \
-    {MODKEY, XK_Return, 0, {.cmd = build_argv("alacritty")}, TYPE_CMD},        \
-        {MODKEY, XK_w, 0, {.cmd = build_argv("firefox")}, TYPE_CMD},           \
-        {MODKEY, XK_space, 0, {.cmd = build_argv("dmenu_run")}, TYPE_CMD},     \
+    {MODKEY, XK_Return, 0, {.cmd = build_pipeline("alacritty")}, TYPE_CMD},    \
+        {MODKEY, XK_w, 0, {.cmd = build_pipeline("firefox")}, TYPE_CMD},       \
+        {MODKEY, XK_space, 0, {.cmd = build_pipeline("dmenu_run")}, TYPE_CMD}, \
         {MODKEY, XK_q, 0, {.fn = close_focused}, TYPE_FUNC},                   \
         {MODKEY | ShiftMask, XK_e, 0, {.fn = quit}, TYPE_FUNC},                \
+        {MODKEY | ShiftMask, XK_r, 0, {.fn = restart}, TYPE_FUNC},             \
         {MODKEY, XK_m, 0, {.fn = toggle_monocle}, TYPE_FUNC},                  \
         {MODKEY, XK_j, 0, {.fn = focus_up}, TYPE_FUNC},                        \
         {MODKEY, XK_k, 0, {.fn = focus_down}, TYPE_FUNC},                      \
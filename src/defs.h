@@ -1,22 +1,50 @@
 #pragma once
+#include <stdio.h>
+#include <sys/types.h>
+
 #include <X11/Xlib.h>
 #define VERSION "tilite ver. 1.0"
 #define AUTHOR "(C) Lance Borden 2026"
 #define LICENSE "Licensed under the GPL v3.0"
 
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
 #define UDIST(a, b) abs((int)(a) - (int)(b))
 #define CLAMP(x, lo, hi) (((x) < (lo)) ? (lo) : ((x) > (hi)) ? (hi) : (x))
 
 #define MAX_CLIENTS 99
+#define MAX_MONITORS 8
 #define MAX_ITEMS 256
+#define MAX_STAGES 8
+#define PIPELINE_NAME_SIZE 64
+#define RULE_STR_SIZE 64
 #define MIN_WINDOW_SIZE 20
+#define KEY_SLOTS_BITS 9 /* 2 * MAX_ITEMS slots, never more than half full */
+#define KEY_SLOTS (1 << KEY_SLOTS_BITS)
+
+#define CLIENT_EVENT_MASK                                                      \
+    (EnterWindowMask | LeaveWindowMask | FocusChangeMask |                     \
+     PropertyChangeMask | StructureNotifyMask | ButtonPressMask |              \
+     ButtonReleaseMask | PointerMotionMask)
+#define ROOT_EVENT_MASK                                                        \
+    (StructureNotifyMask | SubstructureRedirectMask | SubstructureNotifyMask | \
+     KeyPressMask | PropertyChangeMask)
+
+#define IPC_MAX_CONNS 16
+#define IPC_IN_SIZE 256
+#define IPC_OUT_SIZE 16384
+#define IPC_LINE_SIZE 128
 
 #define TYPE_WS_CHANGE 0
 #define TYPE_WS_MOVE 1
 #define TYPE_FUNC 2
 #define TYPE_CMD 3
 
+/* what happens to tiled windows under the monocle or a fullscreen one */
+#define COVER_SHOW 0   /* leaves them be */
+#define COVER_HIDDEN 1 /* marks them _NET_WM_STATE_HIDDEN */
+#define COVER_UNMAP 2  /* marks them and unmaps them too */
+
 #define NUM_WORKSPACES 9
 #define WORKSPACE_NAMES                                                        \
     "1"                                                                        \
@@ -41,8 +69,44 @@
 typedef enum { DRAG_NONE, DRAG_MOVE, DRAG_RESIZE, DRAG_SWAP } DragMode;
 typedef void (*event_t)(XEvent *);
 
+/* a command line split once, when the config is loaded, into its "|"
+ * separated stages. each stage is a NULL terminated argv inside tokens */
+typedef struct {
+    char **tokens; /* the "|" tokens themselves are NULL */
+    int n_tokens;
+    int n_stages;
+    char **stage[MAX_STAGES];
+    char name[PIPELINE_NAME_SIZE]; /* the command line, for launch stats */
+} pipeline_t;
+
+/* a program started with tilite */
+typedef struct {
+    pipeline_t *cmd;
+    int ws; /* its first window goes here, -1 for wherever it would */
+} autostart_t;
+
+/* what a window rule does to the windows it matches */
+typedef struct {
+    int ws; /* -1 leaves the workspace alone */
+    Bool floating;
+    Bool fullscreen;
+    Bool sticky; /* floats and follows every workspace switch */
+    Bool no_focus;
+    int x, y, w, h; /* floating geometry on its monitor, w 0 for none */
+} rule_action_t;
+
+/* matches windows on every field that is not "". title matches anywhere in
+ * the title, type is a _NET_WM_WINDOW_TYPE_* suffix such as "dialog" */
+typedef struct {
+    char class[RULE_STR_SIZE];
+    char instance[RULE_STR_SIZE];
+    char title[RULE_STR_SIZE];
+    char type[RULE_STR_SIZE];
+    rule_action_t action;
+} rule_t;
+
 typedef union {
-    const char **cmd;
+    pipeline_t *cmd;
     void (*fn)(void);
     int ws;
 } action_t;
@@ -55,6 +119,22 @@ typedef struct {
     int type;
 } binding_t;
 
+/* bindings by keycode and cleaned modifier mask, open addressed. one table
+ * per key mode, so a mode switch is a pointer swap */
+typedef struct {
+    unsigned int key[KEY_SLOTS]; /* keycode << 16 | mods */
+    binding_t *bind[KEY_SLOTS];  /* NULL for an empty slot */
+} key_table_t;
+
+/* WM_NORMAL_HINTS as far as tiling goes, every field 0 when unset */
+typedef struct {
+    int base_w, base_h;
+    int inc_w, inc_h;
+    int min_w, min_h;
+    int max_w, max_h;
+    float min_aspect, max_aspect; /* width / height */
+} size_hints_t;
+
 typedef struct client_t {
     Window win;
     int x, y, w, h;
@@ -63,10 +143,21 @@ typedef struct client_t {
     Bool fixed;
     Bool floating;
     Bool fullscreen;
+    Bool sticky;
     Bool mapped;
+    int hidden; /* COVER_* it is covered with, COVER_SHOW if it isn't */
+    long bypass; /* its own _NET_WM_BYPASS_COMPOSITOR, -1 for none */
+    size_hints_t hints;
     struct client_t *next;
 } client_t;
 
+typedef struct {
+    int x, y, w, h;
+    /* taken by docks' struts, from each edge */
+    int reserve_left, reserve_right, reserve_top, reserve_bottom;
+    int ws; /* workspace on screen */
+} monitor_t;
+
 typedef struct {
     int modkey;
     int gaps;
@@ -82,8 +173,13 @@ typedef struct {
     Bool new_win_focus;
     Bool warp_cursor;
     Bool floating_on_top;
+    int monocle_hide;
+    int fullscreen_hide;
+    int n_to_run;
+    int n_rules;
     binding_t binds[MAX_ITEMS];
-    char *to_run[MAX_ITEMS];
+    autostart_t to_run[MAX_ITEMS];
+    rule_t rules[MAX_ITEMS];
 } config_t;
 
 typedef struct {
@@ -124,26 +220,52 @@ typedef enum {
     ATOM_NET_WM_WINDOW_TYPE_NOTIFICATION,
     ATOM_NET_WM_STATE_MODAL,
     ATOM_WM_PROTOCOLS,
+    ATOM_NET_STARTUP_ID,
+    ATOM_NET_WM_STATE_HIDDEN,
+    ATOM_NET_WM_BYPASS_COMPOSITOR,
     ATOM_COUNT
 } atom_type_t;
 
-typedef enum { BSP_LEAF, BSP_SPLIT_V, BSP_SPLIT_H } bsp_type_t;
+typedef enum {
+    IPC_EV_WORKSPACE,
+    IPC_EV_ADD,
+    IPC_EV_REMOVE,
+    IPC_EV_MOVE,
+    IPC_EV_FOCUS,
+    IPC_EV_LAYOUT
+} ipc_event_t;
+
+struct bsp_node_t;
+struct pollfd;
+struct win_query_t;
 
-typedef struct bsp_node_t {
-    bsp_type_t type;
-    /* for leaf nodes */
-    client_t *client;
-    struct bsp_node_t *first;  /* left / top  */
-    struct bsp_node_t *second; /* right / bottom */
-    struct bsp_node_t *parent;
-} bsp_node_t;
+extern Atom atoms[ATOM_COUNT];
+extern const char *event_names[LASTEvent];
+extern Display *dpy;
+extern Window root;
+extern client_t *workspaces[NUM_WORKSPACES];
+extern monitor_t monitors[MAX_MONITORS];
+extern int n_monitors;
+extern int ws_mon[NUM_WORKSPACES];
+extern int scr_width;
+extern int scr_height;
+extern client_t *focused;
+extern config_t user_config;
+extern client_t *ws_focused[NUM_WORKSPACES];
+extern struct bsp_node_t *bsp_roots[NUM_WORKSPACES];
+extern int current_ws;
+extern Bool monocle;
+extern Bool global_floating;
+extern Bool running;
+extern Bool adopting;
+extern int open_windows;
 
-const char **build_argv(const char *cmd);
-client_t *add_client(Window w, int ws);
+client_t *add_client(Window w, int ws, const struct win_query_t *q);
+void apply_config(const config_t *next);
 void apply_fullscreen(client_t *c, Bool on);
-bsp_node_t *bsp_insert(bsp_node_t **root, client_t *old_client,
-                       client_t *new_client);
-void bsp_remove(bsp_node_t **root, client_t *c);
+void autostart(void);
+Bool bind_grabbable(const binding_t *bind);
+pipeline_t *build_pipeline(const char *cmd);
 void change_workspace(int ws);
 int clean_mask(int mask);
 void close_focused(void);
@@ -153,10 +275,15 @@ void focus_down(void);
 void focus_left(void);
 void focus_right(void);
 void focus_up(void);
-int get_workspace_for_window(Window w);
+void free_pipeline(pipeline_t *p);
+int get_workspace_for_window(const struct win_query_t *q);
+void grab_bind(binding_t *bind, Bool grab);
 void grab_button(Mask button, Mask mod, Window w, Bool owner_events,
                  Mask masks);
+void grab_client_buttons(Window w);
+void grab_keycode(KeyCode code, int mods, Bool grab);
 void grab_keys(void);
+void grab_root_buttons(void);
 void hdl_button(XEvent *xev);
 void hdl_button_release(XEvent *xev);
 void hdl_client_msg(XEvent *xev);
@@ -170,6 +297,31 @@ void hdl_map_req(XEvent *xev);
 void hdl_motion(XEvent *xev);
 void hdl_property_ntf(XEvent *xev);
 void hdl_unmap_ntf(XEvent *xev);
+void ipc_cleanup(void);
+void ipc_dispatch(struct pollfd *pfds, int n);
+void ipc_flush(void);
+void ipc_init(void);
+void ipc_notify(ipc_event_t ev, Window w, int arg);
+int ipc_pollfds(struct pollfd *pfds);
+void key_table_build(key_table_t *t, binding_t *binds, int n);
+binding_t *key_table_find(const key_table_t *t, KeyCode code, int mods);
+void launch_batch(Bool on);
+int launch_batch_wait(void);
+void launch_dispatch(struct pollfd *pfd);
+void launch_dump(FILE *f);
+void launch_init(void);
+int launch_mapped(long pid, const char *startup_id, Bool *batch);
+Bool launch_pending(void);
+int launch_pollfd(struct pollfd *pfd);
+char *const *launch_start(const pipeline_t *p, int ws);
+void launch_track(pid_t pid, int err);
+void load_config(config_t *cfg);
+int monitor_at(int x, int y);
+Bool monitor_event(XEvent *xev);
+void monitor_init(void);
+int monitor_neighbor(int mon, int dir);
+void monitor_show(int m, int ws);
+int monitor_update(void);
 void move_focused_down(void);
 void move_focused_left(void);
 void move_focused_right(void);
@@ -183,23 +335,44 @@ void other_wm(void);
 int other_wm_err(Display *d, XErrorEvent *ee);
 long parse_col(const char *hex);
 void quit(void);
+void rc_cleanup(void);
+void rc_dispatch(struct pollfd *pfd);
+void rc_init(void);
+int rc_pollfd(struct pollfd *pfd);
+int rc_reload(void);
+void record_close(void);
+void record_event(XEvent *xev);
+void record_flush(void);
+int record_open(const char *path);
+void record_screens(void);
 void resize_win_down(void);
 void resize_win_left(void);
 void resize_win_right(void);
 void resize_win_up(void);
+void restart(void);
+int restart_load(int fd);
+int restart_save(FILE *f);
+void rules_apply(const struct win_query_t *q, rule_action_t *out);
+void rules_build(const config_t *cfg);
+Bool rules_need_title(void);
 void run(void);
 void scan_existing_windows(void);
 void select_input(Window w, Mask masks);
 void send_wm_take_focus(Window w);
 void setup(void);
 void setup_atoms(void);
+void set_current_ws(int ws);
 void set_frame_extents(Window w);
 void set_input_focus(client_t *c, Bool raise_win, Bool warp);
 void set_wm_state(Window w, long state);
+void shm_cleanup(void);
+void shm_init(void);
+void shm_update(void);
 int snap_coordinate(int pos, int size, int screen_size, int snap_dist);
-void spawn(const char *const *argv);
+void spawn(const pipeline_t *p, int ws);
 void swap_clients(client_t *a, client_t *b);
 void tile(void);
+void tile_ws(int ws);
 void toggle_floating(void);
 void toggle_floating_global(void);
 void toggle_fullscreen(void);
@@ -207,11 +380,13 @@ void toggle_monocle(void);
 void update_borders(void);
 void update_client_desktop_properties(void);
 void update_modifier_masks(void);
+void update_monitors(void);
 void update_net_client_list(void);
 void update_struts(void);
 void update_workarea(void);
 void warp_cursor(client_t *c);
 Bool window_has_ewmh_state(Window w, Atom state);
 void window_set_ewmh_state(Window w, Atom state, Bool add);
+Bool ws_visible(int ws);
 int xerr(Display *d, XErrorEvent *ee);
 void xev_case(XEvent *xev);
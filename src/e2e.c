@@ -0,0 +1,212 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <X11/Xlib.h>
+
+#include "harness.h"
+
+/* tilite-e2e: end to end benchmark. runs tilite under a private Xvfb (see
+ * harness.c), then acts as N plain Xlib clients and times what the wm does
+ * for them:
+ *   map      XMapWindow -> ConfigureNotify from tile()
+ *   destroy  XDestroyWindow -> first ConfigureNotify of a surviving window
+ *   switch   _NET_CURRENT_DESKTOP message -> the property changing on root
+ * bytes the wm wrote to and read from the server are reported per phase, and
+ * for destroy also the Expose events (and exposed pixels) the clients got
+ * per relayout, counted until the wm has been quiet for E2E_SETTLE_MS.
+ * everything goes to stdout as json. */
+
+#define E2E_TIMEOUT_MS 1000
+#define E2E_SETTLE_MS 20
+#define E2E_SWITCHES 50
+
+typedef struct {
+    uint64_t *ns;
+    int n;
+    int timeouts;
+    long bytes_out;
+    long bytes_in;
+    long exposes;
+    long exposed_px;
+} e2e_phase_t;
+
+static Display *dpy;
+static Window root;
+static Atom net_current_desktop;
+
+static void phase_begin(e2e_phase_t *p, int cap) {
+    *p = (e2e_phase_t){calloc(cap, sizeof(uint64_t)), 0, 0, 0, 0, 0, 0};
+    if (!p->ns)
+        harness_die("out of memory");
+    harness_wm_io(&p->bytes_out, &p->bytes_in);
+}
+
+static void phase_end(e2e_phase_t *p) {
+    long out, in;
+    harness_wm_io(&out, &in);
+    p->bytes_out = out - p->bytes_out;
+    p->bytes_in = in - p->bytes_in;
+}
+
+static Bool match_configure(XEvent *ev, void *arg) {
+    return ev->type == ConfigureNotify &&
+           ev->xconfigure.window == *(Window *)arg;
+}
+
+/* counts exposes into the phase at arg on the way */
+static Bool match_any_configure(XEvent *ev, void *arg) {
+    e2e_phase_t *p = arg;
+    if (ev->type == Expose) {
+        p->exposes++;
+        p->exposed_px += (long)ev->xexpose.width * ev->xexpose.height;
+    }
+    return ev->type == ConfigureNotify;
+}
+
+static Bool match_expose_only(XEvent *ev, void *arg) {
+    match_any_configure(ev, arg);
+    return ev->type == Expose;
+}
+
+static Bool match_desktop(XEvent *ev, void *arg) {
+    (void)arg;
+    return ev->type == PropertyNotify && ev->xproperty.window == root &&
+           ev->xproperty.atom == net_current_desktop;
+}
+
+static void print_phase(const char *name, e2e_phase_t *p, Bool last) {
+    uint64_t sum = 0;
+    for (int i = 0; i < p->n; i++)
+        sum += p->ns[i];
+
+#define PCT(q) (harness_percentile(p->ns, p->n, q) / 1e3)
+    printf("      \"%s\": {\"count\": %d, \"timeouts\": %d, "
+           "\"mean_us\": %.1f, \"p50_us\": %.1f, \"p99_us\": %.1f, "
+           "\"max_us\": %.1f, \"wm_bytes_out\": %ld, \"wm_bytes_in\": %ld, "
+           "\"exposes_per_op\": %.1f, \"exposed_px_per_op\": %.0f}%s\n",
+           name, p->n, p->timeouts, p->n ? sum / 1e3 / p->n : 0.0, PCT(50),
+           PCT(99), PCT(100), p->bytes_out, p->bytes_in,
+           p->n ? (double)p->exposes / p->n : 0.0,
+           p->n ? (double)p->exposed_px / p->n : 0.0, last ? "" : ",");
+#undef PCT
+    free(p->ns);
+}
+
+static void run(const char *wm, int n, Bool last) {
+    dpy = harness_start(wm);
+    root = DefaultRootWindow(dpy);
+    net_current_desktop = XInternAtom(dpy, "_NET_CURRENT_DESKTOP", False);
+
+    Window *wins = calloc(n, sizeof(Window));
+    if (!wins)
+        harness_die("out of memory");
+
+    e2e_phase_t map, destroy, sw;
+
+    /* map one at a time so each latency is a single hdl_map_req + tile() */
+    phase_begin(&map, n);
+    int managed = 0;
+    for (int i = 0; i < n; i++) {
+        wins[i] = XCreateSimpleWindow(dpy, root, 0, 0, 1, 1, 0, 0, 0);
+        XSelectInput(dpy, wins[i], StructureNotifyMask | ExposureMask);
+        harness_drain(dpy);
+
+        uint64_t t = harness_now();
+        XMapWindow(dpy, wins[i]);
+        XFlush(dpy);
+        if (!harness_wait_event(dpy, match_configure, &wins[i],
+                                E2E_TIMEOUT_MS)) {
+            /* the wm refused it, most likely MAX_CLIENTS */
+            map.timeouts++;
+            XDestroyWindow(dpy, wins[i]);
+            break;
+        }
+        map.ns[map.n++] = harness_now() - t;
+        managed++;
+    }
+    phase_end(&map);
+
+    /* switch to an empty workspace and back, both directions hit tile() */
+    XSelectInput(dpy, root, PropertyChangeMask);
+    phase_begin(&sw, E2E_SWITCHES);
+    for (int i = 0; i < E2E_SWITCHES; i++) {
+        XEvent ev = {.xclient = {.type = ClientMessage,
+                                 .window = root,
+                                 .message_type = net_current_desktop,
+                                 .format = 32}};
+        ev.xclient.data.l[0] = (i + 1) % 2;
+        harness_drain(dpy);
+
+        uint64_t t = harness_now();
+        XSendEvent(dpy, root, False,
+                   SubstructureRedirectMask | SubstructureNotifyMask, &ev);
+        XFlush(dpy);
+        if (harness_wait_event(dpy, match_desktop, NULL, E2E_TIMEOUT_MS))
+            sw.ns[sw.n++] = harness_now() - t;
+        else
+            sw.timeouts++;
+    }
+    phase_end(&sw);
+
+    /* destroy from the newest down, the sibling leaf grows each time */
+    phase_begin(&destroy, managed);
+    for (int i = managed - 1; i > 0; i--) {
+        harness_drain(dpy);
+
+        uint64_t t = harness_now();
+        XDestroyWindow(dpy, wins[i]);
+        XFlush(dpy);
+        if (harness_wait_event(dpy, match_any_configure, &destroy,
+                               E2E_TIMEOUT_MS))
+            destroy.ns[destroy.n++] = harness_now() - t;
+        else
+            destroy.timeouts++;
+        /* the rest of the relayout and the exposes it caused */
+        while (harness_wait_event(dpy, match_expose_only, &destroy,
+                                  E2E_SETTLE_MS))
+            ;
+    }
+    phase_end(&destroy);
+
+    printf("    {\n      \"clients\": %d,\n      \"managed\": %d,\n", n,
+           managed);
+    print_phase("map", &map, False);
+    print_phase("switch", &sw, False);
+    print_phase("destroy", &destroy, True);
+    printf("    }%s\n", last ? "" : ",");
+    fflush(stdout);
+
+    free(wins);
+    harness_stop(dpy);
+}
+
+int main(int ac, char **av) {
+    static const int sizes[] = {10, 100, 1000};
+    const char *wm = "./tilite";
+    int first = 1;
+
+    if (ac > 2 && strcmp(av[1], "-w") == 0) {
+        wm = av[2];
+        first = 3;
+    }
+    for (int i = first; i < ac; i++) {
+        if (atoi(av[i]) < 1) {
+            fprintf(stderr, "usage: tilite-e2e [-w wm] [clients ...]\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("{\n  \"wm\": \"%s\",\n  \"runs\": [\n", wm);
+    if (first < ac) {
+        for (int i = first; i < ac; i++)
+            run(wm, atoi(av[i]), i == ac - 1);
+    } else {
+        int n_sizes = sizeof(sizes) / sizeof(sizes[0]);
+        for (int i = 0; i < n_sizes; i++)
+            run(wm, sizes[i], i == n_sizes - 1);
+    }
+    printf("  ]\n}\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,200 @@
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+
+#include "harness.h"
+
+pid_t harness_wm_pid = -1;
+static pid_t xvfb_pid = -1;
+
+static pid_t start(const char *const argv[], int out_fd) {
+    pid_t pid = fork();
+    if (pid < 0)
+        harness_die("fork failed");
+    if (pid == 0) {
+        if (out_fd >= 0) {
+            dup2(out_fd, STDOUT_FILENO);
+            close(out_fd);
+        }
+        execvp(argv[0], (char *const *)argv);
+        _exit(127);
+    }
+    return pid;
+}
+
+static void stop(pid_t *pid) {
+    if (*pid <= 0)
+        return;
+    kill(*pid, SIGTERM);
+    waitpid(*pid, NULL, 0);
+    *pid = -1;
+}
+
+static void start_xvfb(void) {
+    int pfd[2];
+    if (pipe(pfd) < 0)
+        harness_die("pipe failed");
+
+    /* Xvfb picks a free display and writes its number to the fd */
+    char fd_arg[16];
+    snprintf(fd_arg, sizeof(fd_arg), "%d", pfd[1]);
+    const char *argv[] = {"Xvfb",      "-displayfd", fd_arg,
+                          "-screen",   "0",          "1920x1080x24",
+                          "-nolisten", "tcp",        "-noreset",
+                          NULL};
+    xvfb_pid = start(argv, -1);
+    close(pfd[1]);
+
+    char buf[16] = {0};
+    ssize_t len = read(pfd[0], buf, sizeof(buf) - 1);
+    close(pfd[0]);
+    if (len <= 0)
+        harness_die("Xvfb did not start");
+
+    char display[20];
+    snprintf(display, sizeof(display), ":%d", atoi(buf));
+    setenv("DISPLAY", display, 1);
+}
+
+static void start_wm(Display *dpy, const char *wm) {
+    int null_fd = open("/dev/null", O_WRONLY);
+    const char *argv[] = {wm, NULL};
+    harness_wm_pid = start(argv, null_fd);
+    if (null_fd >= 0)
+        close(null_fd);
+
+    /* the wm is up once it has published its check window */
+    Atom check = XInternAtom(dpy, "_NET_SUPPORTING_WM_CHECK", False);
+    for (int i = 0; i < 500; i++) {
+        Atom type;
+        int format;
+        unsigned long n, after;
+        unsigned char *data = NULL;
+        if (XGetWindowProperty(dpy, DefaultRootWindow(dpy), check, 0, 1, False,
+                               XA_WINDOW, &type, &format, &n, &after,
+                               &data) == Success &&
+            data) {
+            XFree(data);
+            if (n)
+                return;
+        }
+        usleep(10000);
+    }
+    harness_die("wm did not start");
+}
+
+void harness_die(const char *msg) {
+    fprintf(stderr, "tilite harness: %s\n", msg);
+    if (harness_wm_pid > 0)
+        kill(harness_wm_pid, SIGTERM);
+    if (xvfb_pid > 0)
+        kill(xvfb_pid, SIGTERM);
+    exit(EXIT_FAILURE);
+}
+
+/* drops whatever the previous step left queued */
+void harness_drain(Display *dpy) {
+    XEvent ev;
+    XSync(dpy, False);
+    while (XPending(dpy))
+        XNextEvent(dpy, &ev);
+}
+
+uint64_t harness_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* sorts ns in place */
+uint64_t harness_percentile(uint64_t *ns, int n, int pct) {
+    if (n <= 0)
+        return 0;
+    qsort(ns, n, sizeof(uint64_t), cmp_u64);
+    return ns[(n - 1) * pct / 100];
+}
+
+/* resident set of the wm, -1 if it is gone */
+long harness_rss_kb(void) {
+    char path[64], line[128];
+    long kb = -1;
+
+    snprintf(path, sizeof(path), "/proc/%ld/status", (long)harness_wm_pid);
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return -1;
+    while (fgets(line, sizeof(line), f))
+        if (sscanf(line, "VmRSS: %ld", &kb) == 1)
+            break;
+    fclose(f);
+    return kb;
+}
+
+Display *harness_start(const char *wm) {
+    signal(SIGPIPE, SIG_IGN);
+    start_xvfb();
+    Display *dpy = XOpenDisplay(NULL);
+    if (!dpy)
+        harness_die("cannot open Xvfb display");
+    start_wm(dpy, wm);
+    return dpy;
+}
+
+void harness_stop(Display *dpy) {
+    XCloseDisplay(dpy);
+    stop(&harness_wm_pid);
+    stop(&xvfb_pid);
+}
+
+/* waits for an event accepted by match, False on timeout */
+Bool harness_wait_event(Display *dpy, harness_match_t match, void *arg,
+                        int timeout_ms) {
+    uint64_t deadline = harness_now() + (uint64_t)timeout_ms * 1000000u;
+    XEvent ev;
+
+    for (;;) {
+        while (XPending(dpy)) {
+            XNextEvent(dpy, &ev);
+            if (match(&ev, arg))
+                return True;
+        }
+        uint64_t now = harness_now();
+        if (now >= deadline)
+            return False;
+        struct pollfd pfd = {ConnectionNumber(dpy), POLLIN, 0};
+        poll(&pfd, 1, (int)((deadline - now) / 1000000u) + 1);
+    }
+}
+
+/* wchar/rchar of the wm, almost all of which is its X connection */
+void harness_wm_io(long *out, long *in) {
+    char path[64], key[32];
+    long val;
+    *out = *in = 0;
+
+    snprintf(path, sizeof(path), "/proc/%ld/io", (long)harness_wm_pid);
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return;
+    while (fscanf(f, "%31s %ld", key, &val) == 2) {
+        if (strcmp(key, "wchar:") == 0)
+            *out = val;
+        else if (strcmp(key, "rchar:") == 0)
+            *in = val;
+    }
+    fclose(f);
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <X11/Xlib.h>
+
+/* shared plumbing of the Xvfb driven tools (tilite-e2e, tilite-latency,
+ * tilite-soak): a private Xvfb, the wm under test on it, event waits with a
+ * deadline and a few numbers about the wm process. */
+
+typedef Bool (*harness_match_t)(XEvent *ev, void *arg);
+
+extern pid_t harness_wm_pid;
+
+void harness_die(const char *msg);
+void harness_drain(Display *dpy);
+uint64_t harness_now(void);
+uint64_t harness_percentile(uint64_t *ns, int n, int pct);
+long harness_rss_kb(void);
+Display *harness_start(const char *wm);
+void harness_stop(Display *dpy);
+Bool harness_wait_event(Display *dpy, harness_match_t match, void *arg,
+                        int timeout_ms);
+void harness_wm_io(long *out, long *in);
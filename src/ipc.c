@@ -0,0 +1,394 @@
+#include <errno.h>
+#include <fcntl.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <X11/Xlib.h>
+
+#include "defs.h"
+#include "layout.h"
+#include "stats.h"
+#include "trace.h"
+
+/* line protocol over a unix socket. a client sends "subscribe" and from then
+ * on receives one line per state change:
+ *
+ *   workspace <n>
+ *   add <win> <ws>
+ *   remove <win>
+ *   move <win> <ws>
+ *   focus <win>
+ *   layout <bsp|monocle>
+ *
+ * subscribers that stop reading are never waited on. once their buffer fills
+ * they are marked lagged, further events are dropped for them, and when the
+ * buffer has drained they get "resync" followed by a fresh snapshot.
+ *
+ * "mem" answers with one line of allocation counters for soak testing:
+ *
+ *   mem clients <n> bsp_nodes <n> heap <bytes>
+ *
+ * heap is -1 where the libc cannot tell.
+ *
+ * "restart" re-execs tilite in place, keeping every layout. "reload" rereads
+ * the config file and answers "ok", or "error" when it did not parse.
+ * "launches" lists the runs, failures and launch to map times of every
+ * command tilite has spawned, see launch.c. */
+
+typedef struct {
+    int fd;
+    Bool subscribed;
+    Bool lagged;
+    size_t in_len;
+    size_t out_len;
+    char in[IPC_IN_SIZE];
+    char out[IPC_OUT_SIZE];
+} ipc_conn_t;
+
+static int listen_fd = -1;
+static char sock_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+static ipc_conn_t conns[IPC_MAX_CONNS];
+static int n_subscribers = 0;
+
+static Window last_focus = None;
+static int last_ws = -1;
+static int last_layout = -1;
+
+static void set_nonblock(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
+
+static void conn_close(ipc_conn_t *conn) {
+    if (conn->subscribed)
+        n_subscribers--;
+    close(conn->fd);
+    memset(conn, 0, sizeof(*conn));
+    conn->fd = -1;
+}
+
+/* appends a whole line or nothing, so a lagged stream never ends mid-line */
+static Bool conn_puts(ipc_conn_t *conn, const char *line, size_t len) {
+    if (conn->out_len + len > sizeof(conn->out))
+        return False;
+    memcpy(conn->out + conn->out_len, line, len);
+    conn->out_len += len;
+    return True;
+}
+
+static void conn_printf(ipc_conn_t *conn, const char *fmt, ...) {
+    char line[IPC_LINE_SIZE];
+    va_list ap;
+
+    va_start(ap, fmt);
+    int len = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+
+    if (len < 0)
+        return;
+    if ((size_t)len >= sizeof(line))
+        len = sizeof(line) - 1;
+    if (!conn_puts(conn, line, len))
+        conn->lagged = True;
+}
+
+static void conn_snapshot(ipc_conn_t *conn) {
+    conn_printf(conn, "workspace %d\n", current_ws);
+    conn_printf(conn, "layout %s\n", monocle ? "monocle" : "bsp");
+    for (int ws = 0; ws < NUM_WORKSPACES; ws++)
+        for (client_t *c = workspaces[ws]; c; c = c->next)
+            conn_printf(conn, "add 0x%lx %d\n", c->win, ws);
+    conn_printf(conn, "focus 0x%lx\n", focused ? focused->win : None);
+}
+
+static void conn_flush(ipc_conn_t *conn) {
+    size_t sent = 0;
+
+    while (sent < conn->out_len) {
+        ssize_t n = send(conn->fd, conn->out + sent, conn->out_len - sent,
+                         MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                conn_close(conn);
+                return;
+            }
+            break;
+        }
+        sent += (size_t)n;
+    }
+
+    memmove(conn->out, conn->out + sent, conn->out_len - sent);
+    conn->out_len -= sent;
+
+    if (conn->lagged && conn->subscribed && conn->out_len == 0) {
+        conn->lagged = False;
+        conn_printf(conn, "resync\n");
+        conn_snapshot(conn);
+    }
+}
+
+static long heap_in_use(void) {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    return (long)mallinfo2().uordblks;
+#else
+    return -1;
+#endif
+}
+
+static void conn_command(ipc_conn_t *conn, const char *cmd) {
+    if (strcmp(cmd, "subscribe") == 0) {
+        if (!conn->subscribed) {
+            conn->subscribed = True;
+            n_subscribers++;
+        }
+        conn_snapshot(conn);
+    } else if (strcmp(cmd, "mem") == 0) {
+        conn_printf(conn, "mem clients %d bsp_nodes %lu heap %ld\n",
+                    open_windows, bsp_nodes_live, heap_in_use());
+    } else if (strcmp(cmd, "launches") == 0) {
+        char *buf = NULL;
+        size_t len = 0;
+        FILE *f = open_memstream(&buf, &len);
+        if (f) {
+            launch_dump(f);
+            fclose(f);
+            if (!conn_puts(conn, buf, len))
+                conn_printf(conn, "error launches too large\n");
+            free(buf);
+        }
+    } else if (strcmp(cmd, "reload") == 0) {
+        conn_printf(conn, rc_reload() == 0 ? "ok\n" : "error reload\n");
+    } else if (strcmp(cmd, "restart") == 0) {
+        restart();
+    } else if (strcmp(cmd, "stats") == 0) {
+#ifdef TILITE_STATS
+        char *buf = NULL;
+        size_t len = 0;
+        FILE *f = open_memstream(&buf, &len);
+        if (f) {
+            stats_dump(f);
+            fclose(f);
+            if (!conn_puts(conn, buf, len))
+                conn_printf(conn, "error stats too large\n");
+            free(buf);
+        }
+#else
+        conn_printf(conn, "error stats not compiled in\n");
+#endif
+    } else if (strncmp(cmd, "trace ", 6) == 0) {
+#ifdef TILITE_TRACE
+        if (trace_dump(cmd + 6) < 0)
+            conn_printf(conn, "error cannot write %s\n", cmd + 6);
+        else
+            conn_printf(conn, "ok %s\n", cmd + 6);
+#else
+        conn_printf(conn, "error trace not compiled in\n");
+#endif
+    } else if (*cmd) {
+        conn_printf(conn, "error unknown command '%s'\n", cmd);
+    }
+}
+
+static void conn_read(ipc_conn_t *conn) {
+    ssize_t n = recv(conn->fd, conn->in + conn->in_len,
+                     sizeof(conn->in) - conn->in_len, MSG_DONTWAIT);
+    if (n <= 0) {
+        if (n < 0 && (errno == EAGAIN || errno == EINTR))
+            return;
+        conn_close(conn);
+        return;
+    }
+    conn->in_len += (size_t)n;
+
+    char *start = conn->in;
+    char *nl;
+    while ((nl = memchr(start, '\n', conn->in_len - (start - conn->in)))) {
+        *nl = '\0';
+        conn_command(conn, start);
+        if (conn->fd < 0)
+            return;
+        start = nl + 1;
+    }
+
+    conn->in_len -= (size_t)(start - conn->in);
+    memmove(conn->in, start, conn->in_len);
+
+    /* a line that can never fit is garbage */
+    if (conn->in_len == sizeof(conn->in))
+        conn_close(conn);
+}
+
+static void accept_conn(void) {
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0)
+        return;
+
+    for (int i = 0; i < IPC_MAX_CONNS; i++) {
+        if (conns[i].fd < 0) {
+            set_nonblock(fd);
+            conns[i].fd = fd;
+            return;
+        }
+    }
+    close(fd);
+}
+
+void ipc_cleanup(void) {
+    for (int i = 0; i < IPC_MAX_CONNS; i++)
+        if (conns[i].fd >= 0)
+            conn_close(&conns[i]);
+
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        unlink(sock_path);
+        listen_fd = -1;
+    }
+}
+
+void ipc_dispatch(struct pollfd *pfds, int n) {
+    for (int i = 0; i < n; i++) {
+        if (!pfds[i].revents)
+            continue;
+
+        if (pfds[i].fd == listen_fd) {
+            accept_conn();
+            continue;
+        }
+
+        for (int j = 0; j < IPC_MAX_CONNS; j++) {
+            ipc_conn_t *conn = &conns[j];
+            if (conn->fd != pfds[i].fd)
+                continue;
+
+            if (pfds[i].revents & (POLLERR | POLLHUP | POLLNVAL))
+                conn_close(conn);
+            else if (pfds[i].revents & POLLIN)
+                conn_read(conn);
+            break;
+        }
+    }
+}
+
+void ipc_flush(void) {
+    for (int i = 0; i < IPC_MAX_CONNS; i++)
+        if (conns[i].fd >= 0 && conns[i].out_len)
+            conn_flush(&conns[i]);
+}
+
+void ipc_init(void) {
+    for (int i = 0; i < IPC_MAX_CONNS; i++)
+        conns[i].fd = -1;
+
+    const char *path = getenv("TILITE_SOCKET");
+    if (path && *path) {
+        snprintf(sock_path, sizeof(sock_path), "%s", path);
+    } else {
+        const char *dir = getenv("XDG_RUNTIME_DIR");
+        snprintf(sock_path, sizeof(sock_path), "%s/tilite%s.sock",
+                 dir && *dir ? dir : "/tmp", DisplayString(dpy));
+    }
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        perror("tilite: ipc socket");
+        return;
+    }
+
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", sock_path);
+    unlink(sock_path);
+
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(listen_fd, IPC_MAX_CONNS) < 0) {
+        perror("tilite: ipc bind");
+        close(listen_fd);
+        listen_fd = -1;
+        return;
+    }
+    set_nonblock(listen_fd);
+
+    /* let bars started by us find the socket */
+    setenv("TILITE_SOCKET", sock_path, 1);
+}
+
+void ipc_notify(ipc_event_t ev, Window w, int arg) {
+    /* dedupe state that handlers report more often than it changes */
+    switch (ev) {
+    case IPC_EV_WORKSPACE:
+        if (arg == last_ws)
+            return;
+        last_ws = arg;
+        break;
+    case IPC_EV_FOCUS:
+        if (w == last_focus)
+            return;
+        last_focus = w;
+        break;
+    case IPC_EV_LAYOUT:
+        if (arg == last_layout)
+            return;
+        last_layout = arg;
+        break;
+    default:
+        break;
+    }
+
+    if (!n_subscribers)
+        return;
+
+    for (int i = 0; i < IPC_MAX_CONNS; i++) {
+        ipc_conn_t *conn = &conns[i];
+        if (conn->fd < 0 || !conn->subscribed || conn->lagged)
+            continue;
+
+        switch (ev) {
+        case IPC_EV_WORKSPACE:
+            conn_printf(conn, "workspace %d\n", arg);
+            break;
+        case IPC_EV_ADD:
+            conn_printf(conn, "add 0x%lx %d\n", w, arg);
+            break;
+        case IPC_EV_REMOVE:
+            conn_printf(conn, "remove 0x%lx\n", w);
+            break;
+        case IPC_EV_MOVE:
+            conn_printf(conn, "move 0x%lx %d\n", w, arg);
+            break;
+        case IPC_EV_FOCUS:
+            conn_printf(conn, "focus 0x%lx\n", w);
+            break;
+        case IPC_EV_LAYOUT:
+            conn_printf(conn, "layout %s\n", arg ? "monocle" : "bsp");
+            break;
+        }
+    }
+}
+
+int ipc_pollfds(struct pollfd *pfds) {
+    int n = 0;
+
+    if (listen_fd < 0)
+        return 0;
+
+    pfds[n++] = (struct pollfd){.fd = listen_fd, .events = POLLIN};
+    for (int i = 0; i < IPC_MAX_CONNS; i++) {
+        if (conns[i].fd < 0)
+            continue;
+        short events = POLLIN;
+        if (conns[i].out_len)
+            events |= POLLOUT;
+        pfds[n++] = (struct pollfd){.fd = conns[i].fd, .events = events};
+    }
+    return n;
+}
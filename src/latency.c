@@ -0,0 +1,256 @@
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <X11/Xlib.h>
+#include <X11/Xproto.h>
+#include <X11/extensions/XTest.h>
+#include <X11/extensions/record.h>
+#include <X11/keysym.h>
+
+#include "config.h"
+#include "harness.h"
+
+/* tilite-latency: keypress to effect latency. runs tilite under a private
+ * Xvfb, injects the default CFG_BINDS chords with XTest and watches the wm's
+ * requests with the RECORD extension on a second connection. the time from
+ * the injected key press to the first ConfigureWindow, MapWindow, UnmapWindow
+ * or SetInputFocus it causes is one sample. */
+
+#define LAT_TIMEOUT_MS 1000
+#define LAT_SETTLE_MS 20
+#define LAT_CLIENTS 4
+
+typedef struct {
+    const char *name;
+    Bool shift;
+    /* alternated so every press changes something */
+    KeySym keys[2];
+} lat_case_t;
+
+/* must match the defaults in config.h */
+static const lat_case_t cases[] = {
+    {"focus", False, {XK_h, XK_l}},
+    {"swap", True, {XK_h, XK_l}},
+    {"workspace", False, {XK_2, XK_1}},
+    {"monocle", False, {XK_m, XK_m}},
+};
+
+static Display *ctl_dpy;
+static Display *rec_dpy;
+static Bool waiting = False;
+static uint64_t first_ns = 0;
+static int first_op = 0;
+static unsigned long recorded = 0;
+
+static void on_record(XPointer closure, XRecordInterceptData *d) {
+    (void)closure;
+    if (d->category == XRecordFromClient && d->data) {
+        recorded++;
+        if (waiting) {
+            first_ns = harness_now();
+            first_op = d->data[0];
+            waiting = False;
+        }
+    }
+    XRecordFreeData(d);
+}
+
+/* processes record data for up to timeout_ms, returns early once the
+ * pending sample arrived if sample is set */
+static void pump(int timeout_ms, Bool sample) {
+    uint64_t deadline = harness_now() + (uint64_t)timeout_ms * 1000000u;
+    for (;;) {
+        XRecordProcessReplies(rec_dpy);
+        uint64_t now = harness_now();
+        if (sample && !waiting)
+            return;
+        if (now >= deadline)
+            return;
+        struct pollfd pfd = {ConnectionNumber(rec_dpy), POLLIN, 0};
+        poll(&pfd, 1, (int)((deadline - now) / 1000000u) + 1);
+    }
+}
+
+/* waits until the wm has been quiet for LAT_SETTLE_MS */
+static void settle(void) {
+    unsigned long before;
+    do {
+        before = recorded;
+        pump(LAT_SETTLE_MS, False);
+    } while (recorded != before);
+}
+
+static KeyCode mod_keycode(unsigned int mask) {
+    XModifierKeymap *map = XGetModifierMapping(ctl_dpy);
+    KeyCode code = 0;
+    int idx = 0;
+
+    while (idx < 8 && !(mask & (1u << idx)))
+        idx++;
+    for (int i = 0; idx < 8 && i < map->max_keypermod && !code; i++)
+        code = map->modifiermap[idx * map->max_keypermod + i];
+    XFreeModifiermap(map);
+    return code;
+}
+
+static const char *op_name(int op) {
+    switch (op) {
+    case X_MapWindow:
+        return "MapWindow";
+    case X_UnmapWindow:
+        return "UnmapWindow";
+    case X_ConfigureWindow:
+        return "ConfigureWindow";
+    case X_SetInputFocus:
+        return "SetInputFocus";
+    default:
+        return "none";
+    }
+}
+
+static Bool match_configure(XEvent *ev, void *arg) {
+    return ev->type == ConfigureNotify &&
+           ev->xconfigure.window == *(Window *)arg;
+}
+
+static void run_case(const lat_case_t *lc, int iterations, Bool last) {
+    uint64_t *ns = calloc(iterations, sizeof(uint64_t));
+    if (!ns)
+        harness_die("out of memory");
+
+    KeyCode mod = mod_keycode(MODKEY);
+    KeyCode shift = XKeysymToKeycode(ctl_dpy, XK_Shift_L);
+    int n = 0, timeouts = 0;
+    int ops[256] = {0};
+
+    for (int i = 0; i < iterations; i++) {
+        KeyCode key = XKeysymToKeycode(ctl_dpy, lc->keys[i % 2]);
+
+        XTestFakeKeyEvent(ctl_dpy, mod, True, CurrentTime);
+        if (lc->shift)
+            XTestFakeKeyEvent(ctl_dpy, shift, True, CurrentTime);
+        XSync(ctl_dpy, False);
+        settle();
+
+        waiting = True;
+        uint64_t t = harness_now();
+        XTestFakeKeyEvent(ctl_dpy, key, True, CurrentTime);
+        XFlush(ctl_dpy);
+        pump(LAT_TIMEOUT_MS, True);
+
+        if (!waiting) {
+            ns[n++] = first_ns - t;
+            ops[first_op]++;
+        } else {
+            waiting = False;
+            timeouts++;
+        }
+
+        XTestFakeKeyEvent(ctl_dpy, key, False, CurrentTime);
+        if (lc->shift)
+            XTestFakeKeyEvent(ctl_dpy, shift, False, CurrentTime);
+        XTestFakeKeyEvent(ctl_dpy, mod, False, CurrentTime);
+        XSync(ctl_dpy, False);
+        settle();
+    }
+
+    uint64_t sum = 0;
+    for (int i = 0; i < n; i++)
+        sum += ns[i];
+
+    int top = 0;
+    for (int i = 1; i < 256; i++)
+        if (ops[i] > ops[top])
+            top = i;
+
+    printf("    \"%s\": {\"count\": %d, \"timeouts\": %d, \"mean_us\": %.1f, "
+           "\"p50_us\": %.1f, \"p99_us\": %.1f, \"max_us\": %.1f, "
+           "\"first_request\": \"%s\"}%s\n",
+           lc->name, n, timeouts, n ? sum / 1e3 / n : 0.0,
+           harness_percentile(ns, n, 50) / 1e3,
+           harness_percentile(ns, n, 99) / 1e3,
+           harness_percentile(ns, n, 100) / 1e3, op_name(ops[top] ? top : 0),
+           last ? "" : ",");
+    fflush(stdout);
+    free(ns);
+}
+
+int main(int ac, char **av) {
+    const char *wm = "./tilite";
+    int iterations = 200;
+
+    for (int i = 1; i < ac; i++) {
+        if (strcmp(av[i], "-w") == 0 && i + 1 < ac) {
+            wm = av[++i];
+        } else if (strcmp(av[i], "-n") == 0 && i + 1 < ac &&
+                   atoi(av[i + 1]) > 0) {
+            iterations = atoi(av[++i]);
+        } else {
+            fprintf(stderr, "usage: tilite-latency [-w wm] [-n presses]\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    ctl_dpy = harness_start(wm);
+
+    int ev_base, err_base, major, minor;
+    if (!XTestQueryExtension(ctl_dpy, &ev_base, &err_base, &major, &minor))
+        harness_die("XTEST extension missing");
+    if (!XRecordQueryVersion(ctl_dpy, &major, &minor))
+        harness_die("RECORD extension missing");
+
+    /* a few tiled clients so focus and swap have somewhere to go */
+    Window root = DefaultRootWindow(ctl_dpy);
+    for (int i = 0; i < LAT_CLIENTS; i++) {
+        Window w = XCreateSimpleWindow(ctl_dpy, root, 0, 0, 1, 1, 0, 0, 0);
+        XSelectInput(ctl_dpy, w, StructureNotifyMask);
+        XMapWindow(ctl_dpy, w);
+        XFlush(ctl_dpy);
+        if (!harness_wait_event(ctl_dpy, match_configure, &w,
+                                LAT_TIMEOUT_MS))
+            harness_die("wm did not tile the test clients");
+    }
+    harness_drain(ctl_dpy);
+
+    rec_dpy = XOpenDisplay(NULL);
+    if (!rec_dpy)
+        harness_die("cannot open record connection");
+
+    XRecordRange *ranges[2] = {XRecordAllocRange(), XRecordAllocRange()};
+    if (!ranges[0] || !ranges[1])
+        harness_die("out of memory");
+    ranges[0]->core_requests.first = X_MapWindow;
+    ranges[0]->core_requests.last = X_ConfigureWindow;
+    ranges[1]->core_requests.first = X_SetInputFocus;
+    ranges[1]->core_requests.last = X_SetInputFocus;
+
+    XRecordClientSpec spec = XRecordAllClients;
+    XRecordContext ctx =
+        XRecordCreateContext(ctl_dpy, 0, &spec, 1, ranges, 2);
+    XFree(ranges[0]);
+    XFree(ranges[1]);
+    if (!ctx)
+        harness_die("cannot create record context");
+    XSync(ctl_dpy, False);
+
+    if (!XRecordEnableContextAsync(rec_dpy, ctx, on_record, NULL))
+        harness_die("cannot enable record context");
+    settle();
+
+    printf("{\n  \"wm\": \"%s\",\n  \"presses\": %d,\n  \"bindings\": {\n", wm,
+           iterations);
+    int n_cases = sizeof(cases) / sizeof(cases[0]);
+    for (int i = 0; i < n_cases; i++)
+        run_case(&cases[i], iterations, i == n_cases - 1);
+    printf("  }\n}\n");
+
+    XRecordDisableContext(ctl_dpy, ctx);
+    XRecordFreeContext(ctl_dpy, ctx);
+    XSync(ctl_dpy, False);
+    XCloseDisplay(rec_dpy);
+    harness_stop(ctl_dpy);
+    return EXIT_SUCCESS;
+}
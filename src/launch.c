@@ -0,0 +1,309 @@
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <X11/Xlib.h>
+
+#include "defs.h"
+
+/* every process spawn() starts, from the launch until it exits. a child is
+ * matched to the first window that carries its pid in _NET_WM_PID, or the
+ * startup id it was handed in DESKTOP_STARTUP_ID (which survives wrapper
+ * scripts that fork, so a child that exits cleanly keeps matching by it
+ * until MAP_TIMEOUT_NS), and that gives its command's launch to map
+ * latency. exits are reaped off a signalfd in the main loop, so a command
+ * that dies is counted as a failure.
+ *
+ * the ipc "launches" command prints one line per command:
+ *
+ *   <runs> <failed> <mapped> <avg_ms> <max_ms> <command>
+ *
+ * avg_ms and max_ms are launch to map, over the runs that mapped a window. */
+
+#define MAX_CHILDREN 128
+#define MAP_TIMEOUT_NS 60000000000ull /* then it isn't getting a window */
+#define STARTUP_PREFIX "tilite-"
+/* an autostart batch has settled once its windows stop coming for this
+ * long, or at the latest after BATCH_MAX_NS */
+#define BATCH_QUIET_NS 200000000ull
+#define BATCH_MAX_NS 2000000000ull
+
+typedef struct {
+    char name[PIPELINE_NAME_SIZE];
+    unsigned long runs, failed, mapped;
+    uint64_t map_ns, max_map_ns;
+} launch_stat_t;
+
+typedef struct {
+    pid_t pid; /* 0 once reaped, a free slot unless still waiting */
+    unsigned long id; /* startup id the child was given */
+    launch_stat_t *stat;
+    uint64_t launched;
+    int ws; /* its first window goes here, -1 for anywhere */
+    Bool batch; /* part of the autostart batch */
+    Bool waiting; /* for its first window */
+} child_t;
+
+static int child_fd = -1;
+static launch_stat_t stats[MAX_ITEMS];
+static int n_stats = 0;
+static child_t children[MAX_CHILDREN];
+static int n_waiting = 0;
+static unsigned long next_id = 1;
+static launch_stat_t *cur_stat;
+static int cur_ws;
+
+static Bool batch_active = False;
+static int n_batch = 0; /* batch children still waiting */
+static uint64_t batch_until, quiet_until;
+
+/* environ with our DESKTOP_STARTUP_ID, rebuilt from the same array on every
+ * launch so it only allocates when the environment grows */
+static char **env;
+static size_t env_cap;
+static char startup_var[64];
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static launch_stat_t *find_stat(const char *name) {
+    for (int i = 0; i < n_stats; i++)
+        if (strcmp(stats[i].name, name) == 0)
+            return &stats[i];
+    if (n_stats == MAX_ITEMS)
+        return NULL;
+    launch_stat_t *s = &stats[n_stats++];
+    snprintf(s->name, sizeof(s->name), "%s", name);
+    return s;
+}
+
+static void stop_waiting(child_t *ch) {
+    if (ch->waiting) {
+        ch->waiting = False;
+        n_waiting--;
+        if (ch->batch)
+            n_batch--;
+    }
+}
+
+static void child_mapped(child_t *ch, uint64_t now) {
+    uint64_t ns = now - ch->launched;
+    stop_waiting(ch);
+    if (ch->batch)
+        quiet_until = now + BATCH_QUIET_NS;
+    if (!ch->stat)
+        return;
+    ch->stat->mapped++;
+    ch->stat->map_ns += ns;
+    if (ns > ch->stat->max_map_ns)
+        ch->stat->max_map_ns = ns;
+}
+
+/* children launched from now until launch_batch(False) form one batch */
+void launch_batch(Bool on) {
+    batch_active = on;
+    if (on) {
+        batch_until = quiet_until = now_ns() + BATCH_MAX_NS;
+        n_batch = 0;
+    }
+}
+
+/* ms until the batch settles, 0 once it has, -1 without one */
+int launch_batch_wait(void) {
+    if (!batch_active)
+        return -1;
+    uint64_t now = now_ns();
+    uint64_t until = MIN(batch_until, quiet_until);
+    if (!n_batch || now >= until)
+        return 0;
+    return (int)((until - now) / 1000000) + 1;
+}
+
+void launch_dispatch(struct pollfd *pfd) {
+    if (!(pfd->revents & POLLIN))
+        return;
+
+    /* one signal may stand for several exits, waitpid finds them all */
+    struct signalfd_siginfo si;
+    while (read(child_fd, &si, sizeof(si)) == sizeof(si))
+        ;
+
+    int status;
+    pid_t pid;
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        child_t *ch = NULL;
+        for (int i = 0; i < MAX_CHILDREN && !ch; i++)
+            if (children[i].pid == pid)
+                ch = &children[i];
+        if (!ch)
+            continue;
+
+        Bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        if (!ok && ch->stat) {
+            ch->stat->failed++;
+            double secs = (now_ns() - ch->launched) / 1e9;
+            if (WIFEXITED(status))
+                fprintf(stderr, "tilite: '%s' exited with %d after %.1fs\n",
+                        ch->stat->name, WEXITSTATUS(status), secs);
+            else
+                fprintf(stderr, "tilite: '%s' killed by signal %d after "
+                        "%.1fs\n", ch->stat->name, WTERMSIG(status), secs);
+        }
+        /* a wrapper that forked the real program and exited cleanly still
+         * has a window coming, which its startup id matches until
+         * MAP_TIMEOUT_NS. only a failed launch stops being waited on */
+        if (!ok)
+            stop_waiting(ch);
+        ch->pid = 0;
+    }
+}
+
+void launch_dump(FILE *f) {
+    for (int i = 0; i < n_stats; i++) {
+        launch_stat_t *s = &stats[i];
+        double avg = s->mapped ? s->map_ns / 1e6 / s->mapped : 0;
+        fprintf(f, "%lu %lu %lu %.1f %.1f %s\n", s->runs, s->failed,
+                s->mapped, avg, s->max_map_ns / 1e6, s->name);
+    }
+}
+
+void launch_init(void) {
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    if (sigprocmask(SIG_BLOCK, &mask, NULL) < 0 ||
+        (child_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC)) < 0) {
+        perror("tilite: signalfd");
+        /* without supervision fall back to letting the kernel reap */
+        sigprocmask(SIG_UNBLOCK, &mask, NULL);
+        signal(SIGCHLD, SIG_IGN);
+        child_fd = -1;
+    }
+}
+
+/* called with the new window's _NET_WM_PID (0 if unset) and
+ * _NET_STARTUP_ID ("" if unset). returns the workspace the child that
+ * opened it asked for, -1 for none, and sets *batch if that child is part
+ * of the autostart batch */
+int launch_mapped(long pid, const char *startup_id, Bool *batch) {
+    *batch = False;
+    if (!n_waiting)
+        return -1;
+
+    unsigned long id = 0;
+    if (strncmp(startup_id, STARTUP_PREFIX, strlen(STARTUP_PREFIX)) == 0)
+        id = strtoul(startup_id + strlen(STARTUP_PREFIX), NULL, 10);
+
+    uint64_t now = now_ns();
+    child_t *match = NULL;
+    for (int i = 0; i < MAX_CHILDREN; i++) {
+        child_t *ch = &children[i];
+        if (!ch->waiting)
+            continue;
+        if (!match && ((pid > 0 && ch->pid == pid) || (id && ch->id == id))) {
+            child_mapped(ch, now);
+            match = ch;
+        } else if ((match && ch->id == match->id) ||
+                   now - ch->launched > MAP_TIMEOUT_NS) {
+            /* the other stages of the same pipeline are not counted again,
+             * and daemons that never map anything stop being waited on */
+            stop_waiting(ch);
+        }
+    }
+    if (!match)
+        return -1;
+    *batch = match->batch;
+    return match->ws;
+}
+
+/* windows are only worth asking for their pid while a launch is waiting */
+Bool launch_pending(void) { return n_waiting > 0; }
+
+int launch_pollfd(struct pollfd *pfd) {
+    if (child_fd < 0)
+        return 0;
+    *pfd = (struct pollfd){.fd = child_fd, .events = POLLIN};
+    return 1;
+}
+
+/* starts a launch of p, whose first window should go to ws. returns the
+ * environment its stages run with */
+char *const *launch_start(const pipeline_t *p, int ws) {
+    extern char **environ;
+
+    cur_ws = ws;
+    cur_stat = find_stat(p->name);
+    if (cur_stat)
+        cur_stat->runs++;
+    snprintf(startup_var, sizeof(startup_var),
+             "DESKTOP_STARTUP_ID=" STARTUP_PREFIX "%lu_TIME0", next_id++);
+
+    size_t n = 0;
+    while (environ[n])
+        n++;
+    if (n + 2 > env_cap) {
+        char **tmp = realloc(env, (n + 2) * sizeof(*env));
+        if (!tmp)
+            return environ;
+        env = tmp;
+        env_cap = n + 2;
+    }
+    size_t k = 0;
+    for (size_t i = 0; i < n; i++)
+        if (strncmp(environ[i], "DESKTOP_STARTUP_ID=", 19) != 0)
+            env[k++] = environ[i];
+    env[k++] = startup_var;
+    env[k] = NULL;
+    return env;
+}
+
+/* one stage of the launch launch_start() began. err is what posix_spawn
+ * returned */
+void launch_track(pid_t pid, int err) {
+    if (err) {
+        if (cur_stat)
+            cur_stat->failed++;
+        return;
+    }
+    if (child_fd < 0)
+        return;
+
+    /* full of long running programs, stop following the oldest one that
+     * already showed its window */
+    uint64_t now = now_ns();
+    child_t *ch = NULL, *oldest = NULL;
+    for (int i = 0; i < MAX_CHILDREN && !ch; i++) {
+        child_t *c = &children[i];
+        /* an exited wrapper whose window never came */
+        if (!c->pid && c->waiting && now - c->launched > MAP_TIMEOUT_NS)
+            stop_waiting(c);
+        if (!c->pid && !c->waiting)
+            ch = c;
+        else if (!c->waiting && (!oldest || c->launched < oldest->launched))
+            oldest = c;
+    }
+    if (!ch && !(ch = oldest))
+        return;
+
+    *ch = (child_t){.pid = pid,
+                    .id = next_id - 1,
+                    .stat = cur_stat,
+                    .launched = now,
+                    .ws = cur_ws,
+                    .batch = batch_active,
+                    .waiting = True};
+    n_waiting++;
+    if (batch_active)
+        n_batch++;
+}
@@ -0,0 +1,401 @@
+#include <limits.h>
+#include <stdlib.h>
+
+#include "defs.h"
+#include "layout.h"
+#include "trace.h"
+
+/* a configure place() decided on, sent once the whole tree is laid out */
+typedef struct {
+    client_t *c;
+    Bool grows;
+} pending_t;
+
+unsigned long bsp_nodes_live = 0;
+
+static pending_t *pending;
+static size_t n_pending, pending_cap;
+
+static bsp_node_t *bsp_alloc(void) {
+    bsp_node_t *n = calloc(1, sizeof(bsp_node_t));
+    if (n)
+        bsp_nodes_live++;
+    return n;
+}
+
+static void bsp_release(bsp_node_t *n) {
+    if (!n)
+        return;
+    bsp_nodes_live--;
+    free(n);
+}
+
+static bsp_node_t *bsp_find_leaf(bsp_node_t *node, client_t *c) {
+    if (!node)
+        return NULL;
+    if (node->type == BSP_LEAF)
+        return (node->client == c) ? node : NULL;
+    bsp_node_t *r = bsp_find_leaf(node->first, c);
+    return r ? r : bsp_find_leaf(node->second, c);
+}
+
+static void rec_configure(void *ctx, client_t *c, int x, int y, int w, int h,
+                          int bw) {
+    layout_rec_t *rec = ctx;
+    rec->requests++;
+
+    if (rec->len == rec->cap) {
+        size_t cap = rec->cap ? rec->cap * 2 : 64;
+        layout_req_t *reqs = realloc(rec->reqs, cap * sizeof(*reqs));
+        if (!reqs)
+            return;
+        rec->reqs = reqs;
+        rec->cap = cap;
+    }
+    rec->reqs[rec->len++] = (layout_req_t){c->win, x, y, w, h, bw};
+}
+
+/* shrinks w x h to the nearest size c's hints allow. the result never
+ * grows past w x h, a minimum bigger than that would cover the neighbours */
+static void fit_hints(const size_hints_t *sh, int *w, int *h) {
+    int fw = *w - sh->base_w, fh = *h - sh->base_h;
+
+    if (sh->max_aspect > 0 && fh > 0 && fw > fh * sh->max_aspect)
+        fw = (int)(fh * sh->max_aspect + 0.5f);
+    else if (sh->min_aspect > 0 && fw > 0 && fw < fh * sh->min_aspect)
+        fh = (int)(fw / sh->min_aspect + 0.5f);
+    if (sh->inc_w > 0)
+        fw -= fw % sh->inc_w;
+    if (sh->inc_h > 0)
+        fh -= fh % sh->inc_h;
+
+    fw = MAX(fw + sh->base_w, sh->min_w);
+    fh = MAX(fh + sh->base_h, sh->min_h);
+    if (sh->max_w > 0)
+        fw = MIN(fw, sh->max_w);
+    if (sh->max_h > 0)
+        fh = MIN(fh, sh->max_h);
+    *w = CLAMP(fw, 1, *w);
+    *h = CLAMP(fh, 1, *h);
+}
+
+/* leaf geometry, skipping the request when nothing changed. a window whose
+ * hints leave part of its cell over is centred in it, so the slack ends up
+ * in the gaps around it */
+static void place(const layout_backend_t *be, client_t *c, int x, int y, int w,
+                  int h, int bw) {
+    int cell_w = MAX(1, w - 2 * bw);
+    int cell_h = MAX(1, h - 2 * bw);
+    int cw = cell_w, ch = cell_h;
+    fit_hints(&c->hints, &cw, &ch);
+    x += (cell_w - cw) / 2;
+    y += (cell_h - ch) / 2;
+    if (c->x == x && c->y == y && c->w == cw && c->h == ch)
+        return;
+
+    if (n_pending == pending_cap) {
+        size_t cap = pending_cap ? pending_cap * 2 : 64;
+        pending_t *p = realloc(pending, cap * sizeof(*p));
+        if (p) {
+            pending = p;
+            pending_cap = cap;
+        }
+    }
+    if (n_pending < pending_cap)
+        pending[n_pending++] = (pending_t){c, cw > c->w || ch > c->h};
+    else
+        be->configure(be->ctx, c, x, y, cw, ch, bw);
+    c->x = x;
+    c->y = y;
+    c->w = cw;
+    c->h = ch;
+}
+
+static void assign_rects(const layout_backend_t *be, bsp_node_t *node, int x,
+                         int y, int w, int h, int gaps, int bw) {
+    if (!node)
+        return;
+
+    if (node->type == BSP_LEAF) {
+        client_t *c = node->client;
+        if (!c || !c->mapped || c->floating || c->fullscreen)
+            return;
+        place(be, c, x, y, w, h, bw);
+        return;
+    }
+
+    if (w >= h) {
+        int lw = (w - gaps) / 2;
+        int rw = w - lw - gaps;
+        assign_rects(be, node->first, x, y, lw, h, gaps, bw);
+        assign_rects(be, node->second, x + lw + gaps, y, rw, h, gaps, bw);
+    } else {
+        int th = (h - gaps) / 2;
+        int bh = h - th - gaps;
+        assign_rects(be, node->first, x, y, w, th, gaps, bw);
+        assign_rects(be, node->second, x, y + th + gaps, w, bh, gaps, bw);
+    }
+}
+
+/* lays out the tree under node. every rect is worked out before any window
+ * is configured, then the windows that shrink or only move go first and the
+ * ones that grow last. a window growing into space its neighbour has not
+ * given up yet would overlap it for a moment, and the server would expose
+ * areas that get covered again right after */
+void bsp_assign_rects(const layout_backend_t *be, bsp_node_t *node, int x,
+                      int y, int w, int h, int gaps, int bw) {
+    TRACE_SCOPE("layout", "bsp_assign_rects");
+    n_pending = 0;
+    assign_rects(be, node, x, y, w, h, gaps, bw);
+    for (int grows = 0; grows < 2; grows++) {
+        for (size_t i = 0; i < n_pending; i++) {
+            client_t *c = pending[i].c;
+            if (pending[i].grows == grows)
+                be->configure(be->ctx, c, c->x, c->y, c->w, c->h, bw);
+        }
+    }
+}
+
+/* Find the best tiled neighbor of 'src' in a given direction among the
+ * clients starting at 'head'.
+ * dir: 0=left, 1=right, 2=up, 3=down */
+client_t *bsp_find_neighbor(client_t *head, client_t *src, int dir) {
+    if (!src || src->floating || !src->mapped)
+        return NULL;
+
+    int src_cx = src->x + src->w / 2;
+    int src_cy = src->y + src->h / 2;
+
+    client_t *best = NULL;
+    int best_dist = INT_MAX;
+
+    for (client_t *c = head; c; c = c->next) {
+        if (c == src || c->floating || !c->mapped || c->fullscreen)
+            continue;
+
+        int c_cx = c->x + c->w / 2;
+        int c_cy = c->y + c->h / 2;
+
+        switch (dir) {
+        case 0: /* left */
+            if (c->x + c->w >= src->x)
+                continue;
+            if (c->y + c->h <= src->y || c->y >= src->y + src->h)
+                continue;
+            {
+                int dist = src_cx - c_cx;
+                if (dist < best_dist) {
+                    best_dist = dist;
+                    best = c;
+                }
+            }
+            break;
+        case 1: /* right */
+            if (c->x <= src->x + src->w)
+                continue;
+            if (c->y + c->h <= src->y || c->y >= src->y + src->h)
+                continue;
+            {
+                int dist = c_cx - src_cx;
+                if (dist < best_dist) {
+                    best_dist = dist;
+                    best = c;
+                }
+            }
+            break;
+        case 2: /* up */
+            if (c->y + c->h >= src->y)
+                continue;
+            if (c->x + c->w <= src->x || c->x >= src->x + src->w)
+                continue;
+            {
+                int dist = src_cy - c_cy;
+                if (dist < best_dist) {
+                    best_dist = dist;
+                    best = c;
+                }
+            }
+            break;
+        case 3: /* down */
+            if (c->y <= src->y + src->h)
+                continue;
+            if (c->x + c->w <= src->x || c->x >= src->x + src->w)
+                continue;
+            {
+                int dist = c_cy - src_cy;
+                if (dist < best_dist) {
+                    best_dist = dist;
+                    best = c;
+                }
+            }
+            break;
+        }
+    }
+    return best;
+}
+
+void bsp_free(bsp_node_t **root) {
+    bsp_node_t *node = *root;
+    if (!node)
+        return;
+    bsp_free(&node->first);
+    bsp_free(&node->second);
+    bsp_release(node);
+    *root = NULL;
+}
+
+bsp_node_t *bsp_make_leaf(client_t *c) {
+    bsp_node_t *n = bsp_alloc();
+    if (!n)
+        return NULL;
+    n->type = BSP_LEAF;
+    n->client = c;
+    return n;
+}
+
+bsp_node_t *bsp_make_split(bsp_type_t type, bsp_node_t *first,
+                           bsp_node_t *second) {
+    bsp_node_t *n = bsp_alloc();
+    if (!n)
+        return NULL;
+    n->type = type;
+    n->first = first;
+    n->second = second;
+    first->parent = n;
+    second->parent = n;
+    return n;
+}
+
+bsp_node_t *bsp_insert(bsp_node_t **root, client_t *old_client,
+                       client_t *new_client) {
+    bsp_node_t *leaf = NULL;
+
+    if (*root == NULL) {
+        *root = bsp_make_leaf(new_client);
+        return *root;
+    }
+
+    /* a second leaf for the same client would outlive it */
+    leaf = bsp_find_leaf(*root, new_client);
+    if (leaf)
+        return leaf;
+
+    leaf = bsp_find_leaf(*root, old_client);
+    if (!leaf) {
+        bsp_node_t *split = bsp_alloc();
+        if (!split)
+            return NULL;
+        split->type = BSP_SPLIT_V;
+        split->first = *root;
+        split->second = bsp_make_leaf(new_client);
+        if (split->first)
+            split->first->parent = split;
+        if (split->second)
+            split->second->parent = split;
+        *root = split;
+        return split;
+    }
+
+    bsp_node_t *split = bsp_alloc();
+    if (!split)
+        return NULL;
+
+    split->type = BSP_SPLIT_V;
+    split->first = bsp_make_leaf(old_client);
+    split->second = bsp_make_leaf(new_client);
+    if (!split->first || !split->second) {
+        bsp_release(split->first);
+        bsp_release(split->second);
+        bsp_release(split);
+        return NULL;
+    }
+    split->first->parent = split;
+    split->second->parent = split;
+    split->parent = leaf->parent;
+
+    if (!leaf->parent) {
+        *root = split;
+    } else {
+        bsp_node_t *p = leaf->parent;
+        if (p->first == leaf)
+            p->first = split;
+        else
+            p->second = split;
+    }
+    bsp_release(leaf);
+    return split;
+}
+
+void bsp_remove(bsp_node_t **root, client_t *c) {
+    if (!*root)
+        return;
+
+    bsp_node_t *leaf = bsp_find_leaf(*root, c);
+    if (!leaf)
+        return;
+
+    if (!leaf->parent) {
+        bsp_release(leaf);
+        *root = NULL;
+        return;
+    }
+
+    bsp_node_t *parent = leaf->parent;
+    bsp_node_t *sibling =
+        (parent->first == leaf) ? parent->second : parent->first;
+    bsp_node_t *grandp = parent->parent;
+
+    sibling->parent = grandp;
+    if (!grandp) {
+        *root = sibling;
+    } else {
+        if (grandp->first == parent)
+            grandp->first = sibling;
+        else
+            grandp->second = sibling;
+    }
+    bsp_release(leaf);
+    bsp_release(parent);
+}
+
+void bsp_swap_leaves(bsp_node_t *root, client_t *a, client_t *b) {
+    bsp_node_t *la = bsp_find_leaf(root, a);
+    bsp_node_t *lb = bsp_find_leaf(root, b);
+    if (!la || !lb)
+        return;
+    la->client = b;
+    lb->client = a;
+}
+
+void layout_monocle(const layout_backend_t *be, client_t **clients, int n,
+                    int x, int y, int w, int h, int bw) {
+    int cell_w = MAX(1, w - 2 * bw);
+    int cell_h = MAX(1, h - 2 * bw);
+    for (int i = 0; i < n; i++) {
+        client_t *c = clients[i];
+        int cw = cell_w, ch = cell_h;
+        fit_hints(&c->hints, &cw, &ch);
+        int cx = x + (cell_w - cw) / 2, cy = y + (cell_h - ch) / 2;
+        if (c->x == cx && c->y == cy && c->w == cw && c->h == ch)
+            continue;
+        c->x = cx;
+        c->y = cy;
+        c->w = cw;
+        c->h = ch;
+        be->configure(be->ctx, c, c->x, c->y, c->w, c->h, bw);
+    }
+}
+
+layout_backend_t layout_rec_backend(layout_rec_t *rec) {
+    return (layout_backend_t){rec_configure, rec};
+}
+
+void layout_rec_free(layout_rec_t *rec) {
+    free(rec->reqs);
+    *rec = (layout_rec_t){0};
+}
+
+void layout_rec_reset(layout_rec_t *rec) {
+    rec->len = 0;
+    rec->requests = 0;
+}
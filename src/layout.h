@@ -0,0 +1,59 @@
+#pragma once
+#include <stddef.h>
+
+#include "defs.h"
+
+/* tiling layout core. nothing in here talks to the X server, every geometry
+ * change goes out through a layout_backend_t. tilite drives it with the Xlib
+ * backend in tilite.c, tilite-bench with the in-memory recorder below. */
+
+typedef enum { BSP_LEAF, BSP_SPLIT_V, BSP_SPLIT_H } bsp_type_t;
+
+typedef struct bsp_node_t {
+    bsp_type_t type;
+    /* for leaf nodes */
+    client_t *client;
+    struct bsp_node_t *first;  /* left / top  */
+    struct bsp_node_t *second; /* right / bottom */
+    struct bsp_node_t *parent;
+} bsp_node_t;
+
+typedef struct {
+    /* move/resize c to the given outer rect, w and h exclude the border */
+    void (*configure)(void *ctx, client_t *c, int x, int y, int w, int h,
+                      int bw);
+    void *ctx;
+} layout_backend_t;
+
+typedef struct {
+    Window win;
+    int x, y, w, h, bw;
+} layout_req_t;
+
+/* recording backend: keeps every configure it is sent */
+typedef struct {
+    layout_req_t *reqs;
+    size_t len;
+    size_t cap;
+    unsigned long requests;
+} layout_rec_t;
+
+/* nodes currently allocated across all trees */
+extern unsigned long bsp_nodes_live;
+
+void bsp_assign_rects(const layout_backend_t *be, bsp_node_t *node, int x,
+                      int y, int w, int h, int gaps, int bw);
+client_t *bsp_find_neighbor(client_t *head, client_t *src, int dir);
+void bsp_free(bsp_node_t **root);
+bsp_node_t *bsp_insert(bsp_node_t **root, client_t *old_client,
+                       client_t *new_client);
+bsp_node_t *bsp_make_leaf(client_t *c);
+bsp_node_t *bsp_make_split(bsp_type_t type, bsp_node_t *first,
+                           bsp_node_t *second);
+void bsp_remove(bsp_node_t **root, client_t *c);
+void bsp_swap_leaves(bsp_node_t *root, client_t *a, client_t *b);
+void layout_monocle(const layout_backend_t *be, client_t **clients, int n,
+                    int x, int y, int w, int h, int bw);
+layout_backend_t layout_rec_backend(layout_rec_t *rec);
+void layout_rec_free(layout_rec_t *rec);
+void layout_rec_reset(layout_rec_t *rec);
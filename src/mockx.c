@@ -0,0 +1,917 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/Xinerama.h>
+#include <X11/extensions/Xrandr.h>
+
+#include "defs.h"
+#include "mockx.h"
+
+#define MOCK_HASH 1024
+#define MOCK_FIRST_WINDOW 0x7f000001ul
+#define MOCK_FIRST_XID 0x7e000001ul
+
+typedef struct mock_prop_t {
+    Atom name;
+    Atom type;
+    int format;
+    unsigned long n;
+    void *data; /* format 32 items are longs, like Xlib hands them out */
+    struct mock_prop_t *next;
+} mock_prop_t;
+
+typedef struct mock_win_t {
+    Window id;
+    Window parent;
+    int x, y, w, h, border;
+    Bool override_redirect;
+    int map_state;
+    Bool alive;
+    mock_prop_t *props;
+    struct mock_win_t *hash_next;
+} mock_win_t;
+
+static Display *mock_dpy = NULL;
+static Screen mock_screen;
+static Window mock_root = None;
+static XID next_xid = MOCK_FIRST_XID;
+static Window next_window = MOCK_FIRST_WINDOW;
+static unsigned long roundtrips = 0;
+
+static mock_win_t *win_hash[MOCK_HASH];
+static mock_win_t **win_order = NULL; /* creation order, for XQueryTree */
+static size_t n_wins = 0, cap_wins = 0;
+
+static char **atom_names = NULL;
+static size_t n_atoms = 0, cap_atoms = 0;
+
+static KeySym keymap[256];
+static int key_min = 8, key_max = 255;
+static XModifierKeymap modmap = {0, NULL};
+
+static XineramaScreenInfo *screens = NULL;
+static int n_screens = 0;
+
+static int ptr_x = 0, ptr_y = 0;
+static XErrorHandler err_handler = NULL;
+
+#define REQ() (((_XPrivDisplay)mock_dpy)->request++)
+#define ROUNDTRIP() (REQ(), roundtrips++)
+
+static void *xalloc(size_t n) {
+    void *p = calloc(1, n ? n : 1);
+    if (!p) {
+        fprintf(stderr, "mockx: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static mock_win_t *win_find(Window w) {
+    for (mock_win_t *m = win_hash[w % MOCK_HASH]; m; m = m->hash_next)
+        if (m->id == w)
+            return m;
+    return NULL;
+}
+
+static mock_win_t *win_live(Window w) {
+    mock_win_t *m = win_find(w);
+    return m && m->alive ? m : NULL;
+}
+
+static mock_win_t *win_get(Window w) {
+    mock_win_t *m = win_find(w);
+    if (m)
+        return m;
+
+    m = xalloc(sizeof(*m));
+    m->id = w;
+    m->parent = mock_root;
+    m->map_state = IsUnmapped;
+    m->alive = True;
+    m->hash_next = win_hash[w % MOCK_HASH];
+    win_hash[w % MOCK_HASH] = m;
+
+    if (n_wins == cap_wins) {
+        cap_wins = cap_wins ? cap_wins * 2 : 64;
+        win_order = realloc(win_order, cap_wins * sizeof(*win_order));
+        if (!win_order) {
+            fprintf(stderr, "mockx: out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    win_order[n_wins++] = m;
+    return m;
+}
+
+static mock_prop_t *prop_find(mock_win_t *m, Atom prop) {
+    for (mock_prop_t *p = m->props; p; p = p->next)
+        if (p->name == prop)
+            return p;
+    return NULL;
+}
+
+static size_t item_size(int format) {
+    return format == 32 ? sizeof(long) : format == 16 ? sizeof(short) : 1;
+}
+
+static void prop_free(mock_prop_t *p) {
+    free(p->data);
+    free(p);
+}
+
+/* public api used by the replayer */
+
+Atom mock_intern(const char *name) {
+    static const char *predefined[XA_LAST_PREDEFINED + 1] = {
+        [XA_ATOM] = "ATOM",
+        [XA_CARDINAL] = "CARDINAL",
+        [XA_STRING] = "STRING",
+        [XA_WINDOW] = "WINDOW",
+        [XA_WM_CLASS] = "WM_CLASS",
+        [XA_WM_HINTS] = "WM_HINTS",
+        [XA_WM_NAME] = "WM_NAME",
+        [XA_WM_NORMAL_HINTS] = "WM_NORMAL_HINTS",
+        [XA_WM_SIZE_HINTS] = "WM_SIZE_HINTS",
+        [XA_WM_TRANSIENT_FOR] = "WM_TRANSIENT_FOR",
+    };
+
+    for (Atom a = 1; a <= XA_LAST_PREDEFINED; a++)
+        if (predefined[a] && strcmp(predefined[a], name) == 0)
+            return a;
+
+    for (size_t i = 0; i < n_atoms; i++)
+        if (strcmp(atom_names[i], name) == 0)
+            return XA_LAST_PREDEFINED + 1 + i;
+
+    if (n_atoms == cap_atoms) {
+        cap_atoms = cap_atoms ? cap_atoms * 2 : 128;
+        atom_names = realloc(atom_names, cap_atoms * sizeof(*atom_names));
+        if (!atom_names) {
+            fprintf(stderr, "mockx: out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    atom_names[n_atoms] = strdup(name);
+    return XA_LAST_PREDEFINED + 1 + n_atoms++;
+}
+
+void mock_init(Window root, int width, int height) {
+    _XPrivDisplay d = xalloc(sizeof(*d));
+    d->fd = -1;
+    d->display_name = ":replay";
+    d->default_screen = 0;
+    d->nscreens = 1;
+    d->screens = &mock_screen;
+    d->min_keycode = 8;
+    d->max_keycode = 255;
+
+    mock_screen.display = (Display *)d;
+    mock_screen.root = root;
+    mock_screen.width = width;
+    mock_screen.height = height;
+    mock_screen.root_depth = 24;
+    mock_screen.cmap = 1;
+    mock_screen.white_pixel = 0xffffff;
+    mock_screen.black_pixel = 0;
+
+    mock_dpy = (Display *)d;
+    mock_root = root;
+    mock_window(root, None, 0, 0, width, height, 0, False, IsViewable);
+}
+
+void mock_keymap(int min, int max, const KeySym *syms) {
+    memset(keymap, 0, sizeof(keymap));
+    key_min = min;
+    key_max = max;
+    for (int k = min; k <= max && k < 256; k++)
+        keymap[k] = syms[k - min];
+}
+
+void mock_modmap(int max_keypermod, const KeyCode *codes) {
+    free(modmap.modifiermap);
+    modmap.max_keypermod = max_keypermod;
+    modmap.modifiermap = xalloc(8 * max_keypermod);
+    memcpy(modmap.modifiermap, codes, 8 * max_keypermod);
+}
+
+/* n outputs as x, y, w, h. without any xinerama is reported inactive */
+void mock_screens(int n, const int (*rects)[4]) {
+    free(screens);
+    screens = n ? xalloc(n * sizeof(*screens)) : NULL;
+    n_screens = n;
+    for (int i = 0; i < n; i++)
+        screens[i] = (XineramaScreenInfo){i, rects[i][0], rects[i][1],
+                                          rects[i][2], rects[i][3]};
+}
+
+void mock_pointer(int x, int y) {
+    ptr_x = x;
+    ptr_y = y;
+}
+
+void mock_prop_del(Window w, Atom prop) {
+    mock_win_t *m = win_find(w);
+    if (!m)
+        return;
+
+    for (mock_prop_t **pp = &m->props; *pp; pp = &(*pp)->next) {
+        if ((*pp)->name == prop) {
+            mock_prop_t *dead = *pp;
+            *pp = dead->next;
+            prop_free(dead);
+            return;
+        }
+    }
+}
+
+void mock_prop_set(Window w, Atom prop, Atom type, int format,
+                   unsigned long n, const void *data) {
+    mock_win_t *m = win_get(w);
+    mock_prop_t *p = prop_find(m, prop);
+    if (!p) {
+        p = xalloc(sizeof(*p));
+        p->name = prop;
+        p->next = m->props;
+        m->props = p;
+    } else {
+        free(p->data);
+    }
+
+    p->type = type;
+    p->format = format;
+    p->n = n;
+    p->data = xalloc(n * item_size(format) + 1);
+    memcpy(p->data, data, n * item_size(format));
+}
+
+unsigned long mock_requests(void) {
+    return mock_dpy ? ((_XPrivDisplay)mock_dpy)->request : 0;
+}
+
+unsigned long mock_roundtrips(void) { return roundtrips; }
+
+void mock_window(Window w, Window parent, int x, int y, int width, int height,
+                 int border, Bool override_redirect, int map_state) {
+    mock_win_t *m = win_get(w);
+    m->parent = parent;
+    m->x = x;
+    m->y = y;
+    m->w = width;
+    m->h = height;
+    m->border = border;
+    m->override_redirect = override_redirect;
+    m->map_state = map_state;
+    m->alive = True;
+}
+
+void mock_window_gone(Window w) {
+    mock_win_t *m = win_find(w);
+    if (!m)
+        return;
+
+    m->alive = False;
+    m->map_state = IsUnmapped;
+    while (m->props) {
+        mock_prop_t *dead = m->props;
+        m->props = dead->next;
+        prop_free(dead);
+    }
+}
+
+/* connection */
+
+Display *XOpenDisplay(const char *name) {
+    (void)name;
+    return mock_dpy;
+}
+
+int XCloseDisplay(Display *d) {
+    (void)d;
+    return 0;
+}
+
+Window XDefaultRootWindow(Display *d) {
+    (void)d;
+    return mock_root;
+}
+
+int XDisplayWidth(Display *d, int scr) {
+    (void)d;
+    (void)scr;
+    return mock_screen.width;
+}
+
+int XDisplayHeight(Display *d, int scr) {
+    (void)d;
+    (void)scr;
+    return mock_screen.height;
+}
+
+int XFlush(Display *d) {
+    (void)d;
+    return 1;
+}
+
+int XSync(Display *d, Bool discard) {
+    (void)d;
+    (void)discard;
+    ROUNDTRIP();
+    return 1;
+}
+
+int XPending(Display *d) {
+    (void)d;
+    return 0;
+}
+
+int XNextEvent(Display *d, XEvent *ev) {
+    (void)d;
+    memset(ev, 0, sizeof(*ev));
+    return 0;
+}
+
+XErrorHandler XSetErrorHandler(XErrorHandler handler) {
+    XErrorHandler old = err_handler;
+    err_handler = handler;
+    return old;
+}
+
+int XFree(void *data) {
+    free(data);
+    return 1;
+}
+
+/* atoms and properties */
+
+Atom XInternAtom(Display *d, const char *name, Bool only_if_exists) {
+    (void)d;
+    (void)only_if_exists;
+    ROUNDTRIP();
+    return mock_intern(name);
+}
+
+char *XGetAtomName(Display *d, Atom a) {
+    (void)d;
+    ROUNDTRIP();
+    if (a > XA_LAST_PREDEFINED && a - XA_LAST_PREDEFINED - 1 < n_atoms)
+        return strdup(atom_names[a - XA_LAST_PREDEFINED - 1]);
+    return NULL;
+}
+
+int XChangeProperty(Display *d, Window w, Atom prop, Atom type, int format,
+                    int mode, const unsigned char *data, int n) {
+    (void)d;
+    REQ();
+
+    mock_win_t *m = win_live(w);
+    if (!m)
+        return BadWindow;
+
+    mock_prop_t *p = prop_find(m, prop);
+    if (mode == PropModeReplace || !p || p->format != format) {
+        mock_prop_set(w, prop, type, format, n, data);
+        return 1;
+    }
+
+    /* append / prepend */
+    size_t sz = item_size(format);
+    unsigned char *buf = xalloc((p->n + n) * sz + 1);
+    if (mode == PropModeAppend) {
+        memcpy(buf, p->data, p->n * sz);
+        memcpy(buf + p->n * sz, data, n * sz);
+    } else {
+        memcpy(buf, data, n * sz);
+        memcpy(buf + n * sz, p->data, p->n * sz);
+    }
+    free(p->data);
+    p->data = buf;
+    p->n += n;
+    return 1;
+}
+
+int XDeleteProperty(Display *d, Window w, Atom prop) {
+    (void)d;
+    REQ();
+    mock_prop_del(w, prop);
+    return 1;
+}
+
+int XGetWindowProperty(Display *d, Window w, Atom prop, long offset,
+                       long length, Bool delete, Atom req_type,
+                       Atom *type_ret, int *format_ret, unsigned long *n_ret,
+                       unsigned long *after_ret, unsigned char **data_ret) {
+    (void)d;
+    ROUNDTRIP();
+
+    *type_ret = None;
+    *format_ret = 0;
+    *n_ret = 0;
+    *after_ret = 0;
+    *data_ret = NULL;
+
+    mock_win_t *m = win_live(w);
+    if (!m)
+        return BadWindow;
+
+    mock_prop_t *p = prop_find(m, prop);
+    if (!p)
+        return Success;
+
+    *type_ret = p->type;
+    *format_ret = p->format;
+    if (req_type != AnyPropertyType && req_type != p->type) {
+        *after_ret = p->n * (p->format / 8);
+        return Success;
+    }
+
+    /* offset and length are in 32 bit units */
+    unsigned long total = p->n * (p->format / 8);
+    unsigned long start = MIN((unsigned long)offset * 4, total);
+    unsigned long bytes = MIN((unsigned long)length * 4, total - start);
+    unsigned long first = start / (p->format / 8);
+    unsigned long n = bytes / (p->format / 8);
+
+    size_t sz = item_size(p->format);
+    *data_ret = xalloc(n * sz + 1);
+    memcpy(*data_ret, (unsigned char *)p->data + first * sz, n * sz);
+    *n_ret = n;
+    *after_ret = total - start - bytes;
+
+    if (delete && !*after_ret)
+        mock_prop_del(w, prop);
+    return Success;
+}
+
+Atom *XListProperties(Display *d, Window w, int *n_ret) {
+    (void)d;
+    ROUNDTRIP();
+
+    *n_ret = 0;
+    mock_win_t *m = win_live(w);
+    if (!m)
+        return NULL;
+
+    for (mock_prop_t *p = m->props; p; p = p->next)
+        (*n_ret)++;
+    if (!*n_ret)
+        return NULL;
+
+    Atom *list = xalloc(*n_ret * sizeof(Atom));
+    int i = 0;
+    for (mock_prop_t *p = m->props; p; p = p->next)
+        list[i++] = p->name;
+    return list;
+}
+
+Status XGetWMProtocols(Display *d, Window w, Atom **protos, int *n) {
+    Atom type;
+    int format;
+    unsigned long n_items, after;
+    unsigned char *data = NULL;
+
+    *protos = NULL;
+    *n = 0;
+    if (XGetWindowProperty(d, w, mock_intern("WM_PROTOCOLS"), 0, 1024, False,
+                           XA_ATOM, &type, &format, &n_items, &after,
+                           &data) != Success ||
+        !data || format != 32) {
+        free(data);
+        return 0;
+    }
+
+    *protos = (Atom *)data;
+    *n = (int)n_items;
+    return 1;
+}
+
+Status XSetWMProtocols(Display *d, Window w, Atom *protos, int n) {
+    XChangeProperty(d, w, mock_intern("WM_PROTOCOLS"), XA_ATOM, 32,
+                    PropModeReplace, (unsigned char *)protos, n);
+    return 1;
+}
+
+int XGetClassHint(Display *d, Window w, XClassHint *ch) {
+    Atom type;
+    int format;
+    unsigned long n, after;
+    unsigned char *data = NULL;
+
+    ch->res_name = NULL;
+    ch->res_class = NULL;
+    if (XGetWindowProperty(d, w, XA_WM_CLASS, 0, 1024, False, XA_STRING,
+                           &type, &format, &n, &after, &data) != Success ||
+        !data || format != 8) {
+        free(data);
+        return 0;
+    }
+
+    size_t name_len = strnlen((char *)data, n);
+    ch->res_name = strndup((char *)data, name_len);
+    ch->res_class = name_len < n ? strndup((char *)data + name_len + 1,
+                                           n - name_len - 1)
+                                 : strdup("");
+    free(data);
+    return 1;
+}
+
+Status XGetTransientForHint(Display *d, Window w, Window *transient) {
+    Atom type;
+    int format;
+    unsigned long n, after;
+    unsigned char *data = NULL;
+
+    *transient = None;
+    if (XGetWindowProperty(d, w, XA_WM_TRANSIENT_FOR, 0, 1, False, XA_WINDOW,
+                           &type, &format, &n, &after, &data) != Success ||
+        !data || n < 1) {
+        free(data);
+        return 0;
+    }
+
+    *transient = ((Window *)data)[0];
+    free(data);
+    return 1;
+}
+
+Status XGetWMNormalHints(Display *d, Window w, XSizeHints *hints,
+                         long *supplied) {
+    Atom type;
+    int format;
+    unsigned long n, after;
+    unsigned char *data = NULL;
+
+    memset(hints, 0, sizeof(*hints));
+    *supplied = 0;
+    if (XGetWindowProperty(d, w, XA_WM_NORMAL_HINTS, 0, 18, False,
+                           XA_WM_SIZE_HINTS, &type, &format, &n, &after,
+                           &data) != Success ||
+        !data || n < 15) {
+        free(data);
+        return 0;
+    }
+
+    long *v = (long *)data;
+    hints->flags = v[0];
+    hints->x = v[1];
+    hints->y = v[2];
+    hints->width = v[3];
+    hints->height = v[4];
+    hints->min_width = v[5];
+    hints->min_height = v[6];
+    hints->max_width = v[7];
+    hints->max_height = v[8];
+    hints->width_inc = v[9];
+    hints->height_inc = v[10];
+    hints->min_aspect.x = v[11];
+    hints->min_aspect.y = v[12];
+    hints->max_aspect.x = v[13];
+    hints->max_aspect.y = v[14];
+    if (n >= 18) {
+        hints->base_width = v[15];
+        hints->base_height = v[16];
+        hints->win_gravity = v[17];
+    }
+    *supplied = PAllHints;
+    free(data);
+    return 1;
+}
+
+/* windows */
+
+Window XCreateSimpleWindow(Display *d, Window parent, int x, int y,
+                           unsigned int w, unsigned int h, unsigned int bw,
+                           unsigned long border, unsigned long bg) {
+    (void)d;
+    (void)border;
+    (void)bg;
+    REQ();
+    Window id = next_window++;
+    mock_window(id, parent, x, y, w, h, bw, False, IsUnmapped);
+    return id;
+}
+
+Status XGetWindowAttributes(Display *d, Window w, XWindowAttributes *wa) {
+    (void)d;
+    ROUNDTRIP();
+
+    mock_win_t *m = win_live(w);
+    if (!m)
+        return 0;
+
+    memset(wa, 0, sizeof(*wa));
+    wa->x = m->x;
+    wa->y = m->y;
+    wa->width = m->w;
+    wa->height = m->h;
+    wa->border_width = m->border;
+    wa->override_redirect = m->override_redirect;
+    wa->map_state = m->map_state;
+    wa->root = mock_root;
+    wa->screen = &mock_screen;
+    return 1;
+}
+
+Status XQueryTree(Display *d, Window w, Window *root_ret, Window *parent_ret,
+                  Window **kids, unsigned int *n_kids) {
+    (void)d;
+    ROUNDTRIP();
+
+    *kids = NULL;
+    *n_kids = 0;
+    mock_win_t *m = win_live(w);
+    if (!m)
+        return 0;
+
+    *root_ret = mock_root;
+    *parent_ret = m->parent;
+
+    for (size_t i = 0; i < n_wins; i++)
+        if (win_order[i]->alive && win_order[i]->parent == w)
+            (*n_kids)++;
+    if (!*n_kids)
+        return 1;
+
+    *kids = xalloc(*n_kids * sizeof(Window));
+    unsigned int k = 0;
+    for (size_t i = 0; i < n_wins; i++)
+        if (win_order[i]->alive && win_order[i]->parent == w)
+            (*kids)[k++] = win_order[i]->id;
+    return 1;
+}
+
+int XConfigureWindow(Display *d, Window w, unsigned int mask,
+                     XWindowChanges *wc) {
+    (void)d;
+    REQ();
+
+    mock_win_t *m = win_live(w);
+    if (!m)
+        return BadWindow;
+    if (mask & CWX)
+        m->x = wc->x;
+    if (mask & CWY)
+        m->y = wc->y;
+    if (mask & CWWidth)
+        m->w = wc->width;
+    if (mask & CWHeight)
+        m->h = wc->height;
+    if (mask & CWBorderWidth)
+        m->border = wc->border_width;
+    return 1;
+}
+
+int XMoveResizeWindow(Display *d, Window w, int x, int y, unsigned int width,
+                      unsigned int height) {
+    XWindowChanges wc = {.x = x, .y = y, .width = width, .height = height};
+    return XConfigureWindow(d, w, CWX | CWY | CWWidth | CWHeight, &wc);
+}
+
+int XMoveWindow(Display *d, Window w, int x, int y) {
+    XWindowChanges wc = {.x = x, .y = y};
+    return XConfigureWindow(d, w, CWX | CWY, &wc);
+}
+
+int XResizeWindow(Display *d, Window w, unsigned int width,
+                  unsigned int height) {
+    XWindowChanges wc = {.width = width, .height = height};
+    return XConfigureWindow(d, w, CWWidth | CWHeight, &wc);
+}
+
+int XSetWindowBorderWidth(Display *d, Window w, unsigned int bw) {
+    XWindowChanges wc = {.border_width = bw};
+    return XConfigureWindow(d, w, CWBorderWidth, &wc);
+}
+
+int XMapWindow(Display *d, Window w) {
+    (void)d;
+    REQ();
+    mock_win_t *m = win_live(w);
+    if (m)
+        m->map_state = IsViewable;
+    return 1;
+}
+
+int XUnmapWindow(Display *d, Window w) {
+    (void)d;
+    REQ();
+    mock_win_t *m = win_live(w);
+    if (m)
+        m->map_state = IsUnmapped;
+    return 1;
+}
+
+/* requests whose only effect on the mock is the request count */
+
+#define MOCK_REQUEST(decl, ...)                                                \
+    int decl {                                                                 \
+        (void)d;                                                               \
+        __VA_ARGS__;                                                           \
+        REQ();                                                                 \
+        return 1;                                                              \
+    }
+
+MOCK_REQUEST(XAllowEvents(Display *d, int mode, Time t), (void)mode, (void)t)
+MOCK_REQUEST(XChangeWindowAttributes(Display *d, Window w, unsigned long mask,
+                                     XSetWindowAttributes *wa),
+             (void)w, (void)mask, (void)wa)
+MOCK_REQUEST(XDefineCursor(Display *d, Window w, Cursor c), (void)w, (void)c)
+MOCK_REQUEST(XFreeCursor(Display *d, Cursor c), (void)c)
+MOCK_REQUEST(XGrabButton(Display *d, unsigned int button, unsigned int mods,
+                         Window w, Bool owner, unsigned int mask, int pmode,
+                         int kmode, Window confine, Cursor c),
+             (void)button, (void)mods, (void)w, (void)owner, (void)mask,
+             (void)pmode, (void)kmode, (void)confine, (void)c)
+MOCK_REQUEST(XGrabKey(Display *d, int code, unsigned int mods, Window w,
+                      Bool owner, int pmode, int kmode),
+             (void)code, (void)mods, (void)w, (void)owner, (void)pmode,
+             (void)kmode)
+MOCK_REQUEST(XGrabServer(Display *d), (void)0)
+MOCK_REQUEST(XKillClient(Display *d, XID id), (void)id)
+MOCK_REQUEST(XRaiseWindow(Display *d, Window w), (void)w)
+MOCK_REQUEST(XSelectInput(Display *d, Window w, long mask), (void)w,
+             (void)mask)
+MOCK_REQUEST(XSetInputFocus(Display *d, Window w, int revert, Time t), (void)w,
+             (void)revert, (void)t)
+MOCK_REQUEST(XSetWindowBorder(Display *d, Window w, unsigned long pixel),
+             (void)w, (void)pixel)
+MOCK_REQUEST(XUngrabButton(Display *d, unsigned int button, unsigned int mods,
+                           Window w),
+             (void)button, (void)mods, (void)w)
+MOCK_REQUEST(XUngrabKey(Display *d, int code, unsigned int mods, Window w),
+             (void)code, (void)mods, (void)w)
+MOCK_REQUEST(XUngrabKeyboard(Display *d, Time t), (void)t)
+MOCK_REQUEST(XUngrabPointer(Display *d, Time t), (void)t)
+MOCK_REQUEST(XUngrabServer(Display *d), (void)0)
+MOCK_REQUEST(XWarpPointer(Display *d, Window src, Window dst, int sx, int sy,
+                          unsigned int sw, unsigned int sh, int dx, int dy),
+             (void)src, (void)dst, (void)sx, (void)sy, (void)sw, (void)sh,
+             ptr_x = dx, ptr_y = dy)
+
+Status XSendEvent(Display *d, Window w, Bool propagate, long mask,
+                  XEvent *ev) {
+    (void)d;
+    (void)w;
+    (void)propagate;
+    (void)mask;
+    (void)ev;
+    REQ();
+    return 1;
+}
+
+int XGrabPointer(Display *d, Window w, Bool owner, unsigned int mask,
+                 int pmode, int kmode, Window confine, Cursor c, Time t) {
+    (void)d;
+    (void)w;
+    (void)owner;
+    (void)mask;
+    (void)pmode;
+    (void)kmode;
+    (void)confine;
+    (void)c;
+    (void)t;
+    ROUNDTRIP();
+    return GrabSuccess;
+}
+
+Bool XQueryPointer(Display *d, Window w, Window *root_ret, Window *child,
+                   int *rx, int *ry, int *wx, int *wy, unsigned int *mask) {
+    (void)d;
+    (void)w;
+    ROUNDTRIP();
+    *root_ret = mock_root;
+    *child = None;
+    *rx = *wx = ptr_x;
+    *ry = *wy = ptr_y;
+    *mask = 0;
+    return True;
+}
+
+Cursor XcursorLibraryLoadCursor(Display *d, const char *file) {
+    (void)d;
+    (void)file;
+    return next_xid++;
+}
+
+Bool XineramaIsActive(Display *d) {
+    (void)d;
+    return n_screens > 0;
+}
+
+XineramaScreenInfo *XineramaQueryScreens(Display *d, int *number) {
+    (void)d;
+    ROUNDTRIP();
+    XineramaScreenInfo *info = xalloc(n_screens * sizeof(*info));
+    memcpy(info, screens, n_screens * sizeof(*info));
+    *number = n_screens;
+    return info;
+}
+
+/* no randr, outputs only change through mock_screens(), which the replayer
+ * calls for every REC_SCREENS in a trace */
+Bool XRRQueryExtension(Display *d, int *event_base, int *error_base) {
+    (void)d;
+    *event_base = *error_base = 0;
+    return False;
+}
+
+void XRRSelectInput(Display *d, Window w, int mask) {
+    (void)d;
+    (void)w;
+    (void)mask;
+    REQ();
+}
+
+int XRRUpdateConfiguration(XEvent *xev) {
+    (void)xev;
+    return 0;
+}
+
+/* colors */
+
+Status XParseColor(Display *d, Colormap cmap, const char *spec, XColor *col) {
+    (void)d;
+    (void)cmap;
+    unsigned int r, g, b;
+    if (sscanf(spec, "#%02x%02x%02x", &r, &g, &b) != 3)
+        return 0;
+    col->red = r * 257;
+    col->green = g * 257;
+    col->blue = b * 257;
+    return 1;
+}
+
+Status XAllocColor(Display *d, Colormap cmap, XColor *col) {
+    (void)d;
+    (void)cmap;
+    ROUNDTRIP();
+    col->pixel = ((unsigned long)(col->red >> 8) << 16) |
+                 ((col->green >> 8) << 8) | (col->blue >> 8);
+    return 1;
+}
+
+/* keyboard */
+
+int XDisplayKeycodes(Display *d, int *min, int *max) {
+    (void)d;
+    *min = key_min;
+    *max = key_max;
+    return 1;
+}
+
+KeySym *XGetKeyboardMapping(Display *d,
+#if NeedWidePrototypes
+                            unsigned int first,
+#else
+                            KeyCode first,
+#endif
+                            int count, int *per) {
+    (void)d;
+    ROUNDTRIP();
+    KeySym *syms = xalloc(count * sizeof(KeySym));
+    for (int i = 0; i < count && first + i < 256; i++)
+        syms[i] = keymap[first + i];
+    *per = 1;
+    return syms;
+}
+
+KeyCode XKeysymToKeycode(Display *d, KeySym sym) {
+    (void)d;
+    for (int k = key_min; k <= key_max && k < 256; k++)
+        if (keymap[k] == sym)
+            return k;
+    return 0;
+}
+
+/* only latin1 names, which are their own keysym */
+KeySym XStringToKeysym(const char *name) {
+    return name[0] && !name[1] ? (KeySym)(unsigned char)name[0] : NoSymbol;
+}
+
+XModifierKeymap *XGetModifierMapping(Display *d) {
+    (void)d;
+    ROUNDTRIP();
+    XModifierKeymap *map = xalloc(sizeof(*map));
+    map->max_keypermod = modmap.max_keypermod;
+    map->modifiermap = xalloc(8 * modmap.max_keypermod + 1);
+    if (modmap.modifiermap)
+        memcpy(map->modifiermap, modmap.modifiermap, 8 * modmap.max_keypermod);
+    return map;
+}
+
+int XFreeModifiermap(XModifierKeymap *map) {
+    if (map) {
+        free(map->modifiermap);
+        free(map);
+    }
+    return 1;
+}
+
+int XRefreshKeyboardMapping(XMappingEvent *ev) {
+    (void)ev;
+    return 1;
+}
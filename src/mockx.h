@@ -0,0 +1,23 @@
+#pragma once
+#include <X11/Xlib.h>
+
+/* in-memory stand-in for the parts of Xlib tilite uses, linked into
+ * tilite-replay instead of libX11. it keeps a table of windows and
+ * properties fed by the replayer, answers queries from it, applies the
+ * handlers' configure/map requests to it and counts every request and round
+ * trip through the display's request serial. */
+
+Atom mock_intern(const char *name);
+void mock_init(Window root, int width, int height);
+void mock_keymap(int min, int max, const KeySym *syms);
+void mock_modmap(int max_keypermod, const KeyCode *codes);
+void mock_pointer(int x, int y);
+void mock_screens(int n, const int (*rects)[4]);
+void mock_prop_del(Window w, Atom prop);
+void mock_prop_set(Window w, Atom prop, Atom type, int format,
+                   unsigned long n, const void *data);
+unsigned long mock_requests(void);
+unsigned long mock_roundtrips(void);
+void mock_window(Window w, Window parent, int x, int y, int width, int height,
+                 int border, Bool override_redirect, int map_state);
+void mock_window_gone(Window w);
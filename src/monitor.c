@@ -0,0 +1,209 @@
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <X11/Xlib.h>
+#include <X11/extensions/Xinerama.h>
+#include <X11/extensions/Xrandr.h>
+
+#include "defs.h"
+
+/* outputs and the workspace each one shows. every workspace belongs to one
+ * monitor at a time, ws_mon[ws], and is on screen while that monitor shows
+ * it, so a workspace's tree is always laid out on exactly one output.
+ * without xinerama the root window is the only monitor. randr only tells us
+ * when to look again. */
+
+monitor_t monitors[MAX_MONITORS];
+int n_monitors = 0;
+int ws_mon[NUM_WORKSPACES];
+
+static int randr_base = -1; /* first randr event type, -1 without randr */
+
+static Bool rect_overlap(int a, int a_len, int b, int b_len) {
+    return a < b + b_len && b < a + a_len;
+}
+
+/* the monitor holding (x, y), -1 when it falls between outputs */
+int monitor_at(int x, int y) {
+    for (int m = 0; m < n_monitors; m++) {
+        monitor_t *mon = &monitors[m];
+        if (x >= mon->x && x < mon->x + mon->w && y >= mon->y &&
+            y < mon->y + mon->h)
+            return m;
+    }
+    return -1;
+}
+
+/* fills monitors[] with the outputs, workspaces are left to the caller */
+static void query_monitors(void) {
+    n_monitors = 0;
+
+    int n = 0;
+    XineramaScreenInfo *info =
+        XineramaIsActive(dpy) ? XineramaQueryScreens(dpy, &n) : NULL;
+    for (int i = 0; info && i < n && n_monitors < MAX_MONITORS; i++) {
+        /* cloned outputs show the same pixels, tile them once */
+        Bool dup = False;
+        for (int m = 0; m < n_monitors && !dup; m++)
+            dup = monitors[m].x == info[i].x_org &&
+                  monitors[m].y == info[i].y_org &&
+                  monitors[m].w == info[i].width &&
+                  monitors[m].h == info[i].height;
+        if (dup || info[i].width <= 0 || info[i].height <= 0)
+            continue;
+        monitors[n_monitors++] = (monitor_t){.x = info[i].x_org,
+                                             .y = info[i].y_org,
+                                             .w = info[i].width,
+                                             .h = info[i].height};
+    }
+    if (info)
+        XFree(info);
+
+    if (!n_monitors)
+        monitors[n_monitors++] =
+            (monitor_t){.w = scr_width, .h = scr_height};
+}
+
+/* true for the randr events that can move outputs. xlib's idea of the
+ * screen size is brought up to date on the way */
+Bool monitor_event(XEvent *xev) {
+    if (randr_base < 0 || (xev->type != randr_base + RRScreenChangeNotify &&
+                           xev->type != randr_base + RRNotify))
+        return False;
+    XRRUpdateConfiguration(xev);
+    return True;
+}
+
+void monitor_init(void) {
+    int err_base;
+    if (XRRQueryExtension(dpy, &randr_base, &err_base))
+        XRRSelectInput(dpy, root,
+                       RRScreenChangeNotifyMask | RRCrtcChangeNotifyMask |
+                           RROutputChangeNotifyMask);
+    else
+        randr_base = -1;
+
+    query_monitors();
+
+    /* monitor m starts out on workspace m, the rest wait on the first */
+    for (int ws = 0; ws < NUM_WORKSPACES; ws++)
+        ws_mon[ws] = ws < n_monitors ? ws : 0;
+    for (int m = 0; m < n_monitors; m++)
+        monitors[m].ws = m;
+}
+
+/* nearest monitor past mon's edge in dir (0=left, 1=right, 2=up, 3=down)
+ * that shares some of that edge, -1 if there is none */
+int monitor_neighbor(int mon, int dir) {
+    monitor_t *src = &monitors[mon];
+    int best = -1, best_dist = INT_MAX;
+
+    for (int m = 0; m < n_monitors; m++) {
+        monitor_t *o = &monitors[m];
+        int dist;
+        if (m == mon)
+            continue;
+        switch (dir) {
+        case 0:
+            dist = src->x - (o->x + o->w);
+            break;
+        case 1:
+            dist = o->x - (src->x + src->w);
+            break;
+        case 2:
+            dist = src->y - (o->y + o->h);
+            break;
+        default:
+            dist = o->y - (src->y + src->h);
+            break;
+        }
+        Bool shared = dir < 2 ? rect_overlap(src->y, src->h, o->y, o->h)
+                              : rect_overlap(src->x, src->w, o->x, o->w);
+        if (dist >= 0 && shared && dist < best_dist) {
+            best = m;
+            best_dist = dist;
+        }
+    }
+    return best;
+}
+
+/* puts ws on monitor m. if it was showing on another monitor the two
+ * monitors trade workspaces, so none is ever on two at once */
+void monitor_show(int m, int ws) {
+    int from = ws_mon[ws];
+    if (from != m && monitors[from].ws == ws) {
+        monitors[from].ws = monitors[m].ws;
+        ws_mon[monitors[m].ws] = from;
+    }
+    monitors[m].ws = ws;
+    ws_mon[ws] = m;
+}
+
+/* rereads the outputs after a hotplug. a monitor at the same origin as an
+ * old one, or failing that in the same slot, carries on with its
+ * workspaces. the workspaces of a monitor that went away move to whichever
+ * monitor now holds its centre, else the first, and are hidden there. new
+ * monitors show a workspace nobody was showing. returns the workspaces whose
+ * monitor moved or changed size, one bit each */
+int monitor_update(void) {
+    monitor_t old[MAX_MONITORS];
+    int n_old = n_monitors;
+    memcpy(old, monitors, sizeof(old));
+    query_monitors();
+
+    int from[MAX_MONITORS], to[MAX_MONITORS];
+    for (int m = 0; m < MAX_MONITORS; m++)
+        from[m] = to[m] = -1;
+    for (int m = 0; m < n_monitors; m++) {
+        for (int o = 0; o < n_old && from[m] < 0; o++) {
+            if (to[o] < 0 && old[o].x == monitors[m].x &&
+                old[o].y == monitors[m].y) {
+                from[m] = o;
+                to[o] = m;
+            }
+        }
+    }
+    for (int m = 0; m < n_monitors; m++) {
+        if (from[m] < 0 && m < n_old && to[m] < 0) {
+            from[m] = m;
+            to[m] = m;
+        }
+    }
+
+    Bool shown[NUM_WORKSPACES] = {0};
+    for (int m = 0; m < n_monitors; m++) {
+        monitors[m].ws = from[m] >= 0 ? old[from[m]].ws : -1;
+        if (monitors[m].ws >= 0)
+            shown[monitors[m].ws] = True;
+    }
+
+    int changed = 0;
+    for (int ws = 0; ws < NUM_WORKSPACES; ws++) {
+        monitor_t *o = &old[ws_mon[ws]];
+        int m = to[ws_mon[ws]];
+        if (m < 0) {
+            m = monitor_at(o->x + o->w / 2, o->y + o->h / 2);
+            m = m < 0 ? 0 : m;
+        }
+        ws_mon[ws] = m;
+        if (monitors[m].x != o->x || monitors[m].y != o->y ||
+            monitors[m].w != o->w || monitors[m].h != o->h)
+            changed |= 1 << ws;
+    }
+
+    for (int m = 0, ws = 0; m < n_monitors; m++) {
+        if (monitors[m].ws >= 0)
+            continue;
+        while (ws < NUM_WORKSPACES - 1 && shown[ws])
+            ws++;
+        shown[ws] = True;
+        if (ws_mon[ws] != m)
+            changed |= 1 << ws;
+        monitors[m].ws = ws;
+        ws_mon[ws] = m;
+    }
+    return changed;
+}
+
+Bool ws_visible(int ws) { return monitors[ws_mon[ws]].ws == ws; }
@@ -0,0 +1,329 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+#include "defs.h"
+#include "query.h"
+#include "xcall.h"
+
+/* just WM_NORMAL_HINTS, for when they change under a managed window */
+void query_hints(Window w, win_query_t *q) {
+    XSizeHints hints;
+    long supplied;
+    q->hint_flags = 0;
+    if (!XGetWMNormalHints(dpy, w, &hints, &supplied))
+        return;
+    q->hint_flags = hints.flags;
+    q->min_w = hints.min_width;
+    q->min_h = hints.min_height;
+    q->max_w = hints.max_width;
+    q->max_h = hints.max_height;
+    q->inc_w = hints.width_inc;
+    q->inc_h = hints.height_inc;
+    q->min_aspect_x = hints.min_aspect.x;
+    q->min_aspect_y = hints.min_aspect.y;
+    q->max_aspect_x = hints.max_aspect.x;
+    q->max_aspect_y = hints.max_aspect.y;
+    q->base_w = hints.base_width;
+    q->base_h = hints.base_height;
+}
+
+/* the replayer's mock display has no xcb connection behind it */
+#if defined(TILITE_XCB) && !defined(TILITE_REPLAY)
+#include <X11/Xlib-xcb.h>
+#include <xcb/xcb.h>
+#include <xcb/xproto.h>
+
+typedef struct {
+    xcb_get_window_attributes_cookie_t attr;
+    xcb_get_geometry_cookie_t geom;
+    xcb_get_property_cookie_t type;
+    xcb_get_property_cookie_t class;
+    xcb_get_property_cookie_t transient;
+    xcb_get_property_cookie_t hints;
+    xcb_get_property_cookie_t state;
+    xcb_get_property_cookie_t desktop;
+    xcb_get_property_cookie_t pid;
+    xcb_get_property_cookie_t startup_id;
+    xcb_get_property_cookie_t net_name;
+    xcb_get_property_cookie_t name;
+    Bool titled; /* the two above were asked for */
+} query_cookies_t;
+
+static xcb_get_property_cookie_t get_prop(xcb_connection_t *conn, Window w,
+                                          Atom prop, Atom type, long len) {
+    return xcb_get_property(conn, 0, (xcb_window_t)w, (xcb_atom_t)prop,
+                            (xcb_atom_t)type, 0, (uint32_t)len);
+}
+
+/* property value as 32 bit items, NULL unless the reply has that format */
+static uint32_t *prop_longs(xcb_get_property_reply_t *r, int *n) {
+    *n = 0;
+    if (!r || r->format != 32)
+        return NULL;
+    *n = xcb_get_property_value_length(r) / 4;
+    return xcb_get_property_value(r);
+}
+
+static void send_queries(xcb_connection_t *conn, Window w,
+                         query_cookies_t *ck) {
+    ck->attr = xcb_get_window_attributes(conn, (xcb_window_t)w);
+    ck->geom = xcb_get_geometry(conn, (xcb_drawable_t)w);
+    ck->type = get_prop(conn, w, atoms[ATOM_NET_WM_WINDOW_TYPE], XA_ATOM,
+                        QUERY_TYPES);
+    ck->class = get_prop(conn, w, XA_WM_CLASS, XA_STRING, 64);
+    ck->transient = get_prop(conn, w, XA_WM_TRANSIENT_FOR, XA_WINDOW, 1);
+    ck->hints =
+        get_prop(conn, w, XA_WM_NORMAL_HINTS, XA_WM_SIZE_HINTS, 18);
+    ck->state = get_prop(conn, w, atoms[ATOM_NET_WM_STATE], XA_ATOM, 1024);
+    ck->desktop =
+        get_prop(conn, w, atoms[ATOM_NET_WM_DESKTOP], XA_CARDINAL, 1);
+    ck->pid = get_prop(conn, w, atoms[ATOM_NET_WM_PID], XA_CARDINAL, 1);
+    ck->startup_id = get_prop(conn, w, atoms[ATOM_NET_STARTUP_ID],
+                              atoms[ATOM_UTF8_STRING], 16);
+    ck->titled = rules_need_title();
+    if (ck->titled) {
+        ck->net_name = get_prop(conn, w, atoms[ATOM_NET_WM_NAME],
+                                atoms[ATOM_UTF8_STRING], 32);
+        ck->name = get_prop(conn, w, XA_WM_NAME, XCB_ATOM_ANY, 32);
+    }
+}
+
+/* copies a text property into buf, False if the reply holds none */
+static Bool prop_text(xcb_get_property_reply_t *r, char *buf, size_t size) {
+    if (!r || r->format != 8 || !xcb_get_property_value_length(r))
+        return False;
+    snprintf(buf, size, "%.*s", xcb_get_property_value_length(r),
+             (const char *)xcb_get_property_value(r));
+    return True;
+}
+
+static void collect_replies(xcb_connection_t *conn, query_cookies_t *ck,
+                            win_query_t *q) {
+    xcb_get_window_attributes_reply_t *attr =
+        xcb_get_window_attributes_reply(conn, ck->attr, NULL);
+    xcb_get_geometry_reply_t *geom = xcb_get_geometry_reply(conn, ck->geom,
+                                                            NULL);
+    q->valid = attr && geom;
+    if (attr) {
+        q->override_redirect = attr->override_redirect;
+        q->map_state = attr->map_state;
+    }
+    if (geom) {
+        q->x = geom->x;
+        q->y = geom->y;
+        q->w = geom->width;
+        q->h = geom->height;
+    }
+    free(attr);
+    free(geom);
+
+    int n;
+    xcb_get_property_reply_t *r =
+        xcb_get_property_reply(conn, ck->type, NULL);
+    uint32_t *v = prop_longs(r, &n);
+    for (int i = 0; v && i < n && i < QUERY_TYPES; i++)
+        q->types[q->n_types++] = v[i];
+    free(r);
+
+    /* WM_CLASS is the instance and the class, each NUL terminated */
+    r = xcb_get_property_reply(conn, ck->class, NULL);
+    if (r && r->format == 8) {
+        const char *s = xcb_get_property_value(r);
+        int len = xcb_get_property_value_length(r);
+        int name_len = strnlen(s, len);
+        snprintf(q->res_name, sizeof(q->res_name), "%.*s", name_len, s);
+        if (name_len < len)
+            snprintf(q->res_class, sizeof(q->res_class), "%.*s",
+                     (int)strnlen(s + name_len + 1, len - name_len - 1),
+                     s + name_len + 1);
+    }
+    free(r);
+
+    r = xcb_get_property_reply(conn, ck->transient, NULL);
+    v = prop_longs(r, &n);
+    if (v && n >= 1)
+        q->transient = v[0];
+    free(r);
+
+    r = xcb_get_property_reply(conn, ck->hints, NULL);
+    v = prop_longs(r, &n);
+    if (v && n >= 15) {
+        int32_t *h = (int32_t *)v;
+        q->hint_flags = h[0];
+        q->min_w = h[5];
+        q->min_h = h[6];
+        q->max_w = h[7];
+        q->max_h = h[8];
+        q->inc_w = h[9];
+        q->inc_h = h[10];
+        q->min_aspect_x = h[11];
+        q->min_aspect_y = h[12];
+        q->max_aspect_x = h[13];
+        q->max_aspect_y = h[14];
+        if (n >= 18) {
+            q->base_w = h[15];
+            q->base_h = h[16];
+        }
+    }
+    free(r);
+
+    r = xcb_get_property_reply(conn, ck->state, NULL);
+    v = prop_longs(r, &n);
+    for (int i = 0; v && i < n; i++)
+        if (v[i] == atoms[ATOM_NET_WM_STATE_FULLSCREEN])
+            q->fullscreen = True;
+    free(r);
+
+    r = xcb_get_property_reply(conn, ck->desktop, NULL);
+    v = prop_longs(r, &n);
+    q->desktop = v && n >= 1 ? (long)v[0] : -1;
+    free(r);
+
+    r = xcb_get_property_reply(conn, ck->pid, NULL);
+    v = prop_longs(r, &n);
+    q->pid = v && n >= 1 ? (long)v[0] : 0;
+    free(r);
+
+    r = xcb_get_property_reply(conn, ck->startup_id, NULL);
+    prop_text(r, q->startup_id, sizeof(q->startup_id));
+    free(r);
+
+    if (!ck->titled)
+        return;
+    r = xcb_get_property_reply(conn, ck->net_name, NULL);
+    Bool named = prop_text(r, q->title, sizeof(q->title));
+    free(r);
+    r = xcb_get_property_reply(conn, ck->name, NULL);
+    if (!named)
+        prop_text(r, q->title, sizeof(q->title));
+    free(r);
+}
+
+void query_windows(const Window *wins, int n, win_query_t *out) {
+    TRACE_SCOPE("xcb", "query_windows");
+    xcb_connection_t *conn = XGetXCBConnection(dpy);
+    query_cookies_t *ck = malloc(n * sizeof(*ck));
+
+    memset(out, 0, n * sizeof(*out));
+    if (!ck) {
+        fprintf(stderr, "tilite: could not alloc memory for queries\n");
+        return;
+    }
+
+    for (int i = 0; i < n; i++)
+        send_queries(conn, wins[i], &ck[i]);
+    STATS_ROUNDTRIP();
+    for (int i = 0; i < n; i++)
+        collect_replies(conn, &ck[i], &out[i]);
+    free(ck);
+}
+#else
+/* copies a text property into buf, False if the window has none */
+static Bool get_text(Window w, Atom prop, Atom req, char *buf, size_t size) {
+    Atom type;
+    int format;
+    unsigned long n_items, after;
+    char *s = NULL;
+    Bool ok = False;
+    if (XGetWindowProperty(dpy, w, prop, 0, 32, False, req, &type, &format,
+                           &n_items, &after,
+                           (unsigned char **)&s) == Success &&
+        s) {
+        if (format == 8 && n_items) {
+            snprintf(buf, size, "%.*s", (int)n_items, s);
+            ok = True;
+        }
+        XFree(s);
+    }
+    return ok;
+}
+
+static void query_one(Window w, win_query_t *q) {
+    q->desktop = -1;
+
+    XWindowAttributes wa;
+    if (!XGetWindowAttributes(dpy, w, &wa))
+        return;
+    q->valid = True;
+    q->override_redirect = wa.override_redirect;
+    q->map_state = wa.map_state;
+    q->x = wa.x;
+    q->y = wa.y;
+    q->w = wa.width;
+    q->h = wa.height;
+
+    Atom type;
+    int format;
+    unsigned long n_items, after;
+    Atom *types = NULL;
+    if (XGetWindowProperty(dpy, w, atoms[ATOM_NET_WM_WINDOW_TYPE], 0,
+                           QUERY_TYPES, False, XA_ATOM, &type, &format,
+                           &n_items, &after,
+                           (unsigned char **)&types) == Success &&
+        types) {
+        for (unsigned long i = 0; i < n_items && i < QUERY_TYPES; i++)
+            q->types[q->n_types++] = types[i];
+        XFree(types);
+    }
+
+    XClassHint ch = {0};
+    if (XGetClassHint(dpy, w, &ch)) {
+        snprintf(q->res_name, sizeof(q->res_name), "%s",
+                 ch.res_name ? ch.res_name : "");
+        snprintf(q->res_class, sizeof(q->res_class), "%s",
+                 ch.res_class ? ch.res_class : "");
+        XFree(ch.res_class);
+        XFree(ch.res_name);
+    }
+
+    Window transient;
+    if (XGetTransientForHint(dpy, w, &transient))
+        q->transient = transient;
+
+    query_hints(w, q);
+
+    q->fullscreen =
+        window_has_ewmh_state(w, atoms[ATOM_NET_WM_STATE_FULLSCREEN]);
+
+    long *desktop = NULL;
+    if (XGetWindowProperty(dpy, w, atoms[ATOM_NET_WM_DESKTOP], 0, 1, False,
+                           XA_CARDINAL, &type, &format, &n_items, &after,
+                           (unsigned char **)&desktop) == Success &&
+        desktop) {
+        if (n_items)
+            q->desktop = desktop[0];
+        XFree(desktop);
+    }
+
+    if (rules_need_title() &&
+        !get_text(w, atoms[ATOM_NET_WM_NAME], atoms[ATOM_UTF8_STRING],
+                  q->title, sizeof(q->title)))
+        get_text(w, XA_WM_NAME, AnyPropertyType, q->title, sizeof(q->title));
+
+    /* two more round trips, only worth it while a launch is being timed */
+    if (!launch_pending())
+        return;
+    long *pid = NULL;
+    if (XGetWindowProperty(dpy, w, atoms[ATOM_NET_WM_PID], 0, 1, False,
+                           XA_CARDINAL, &type, &format, &n_items, &after,
+                           (unsigned char **)&pid) == Success &&
+        pid) {
+        if (n_items)
+            q->pid = pid[0];
+        XFree(pid);
+    }
+    get_text(w, atoms[ATOM_NET_STARTUP_ID], atoms[ATOM_UTF8_STRING],
+             q->startup_id, sizeof(q->startup_id));
+}
+
+void query_windows(const Window *wins, int n, win_query_t *out) {
+    memset(out, 0, n * sizeof(*out));
+    for (int i = 0; i < n; i++)
+        query_one(wins[i], &out[i]);
+}
+#endif
@@ -0,0 +1,39 @@
+#pragma once
+#include <X11/Xlib.h>
+
+/* everything the map path wants to know about a window, fetched in one go.
+ * built with -DTILITE_XCB (see Makefile) every request for a batch of
+ * windows goes out before the first reply is read, so a batch costs one
+ * round trip however many windows it holds. otherwise it falls back to the
+ * blocking Xlib calls, one after another. */
+
+#define QUERY_TYPES 4
+
+typedef struct win_query_t {
+    Bool valid; /* False when the window's attributes could not be read */
+    Bool override_redirect;
+    int map_state;
+    int x, y, w, h;
+    Atom types[QUERY_TYPES];
+    int n_types;
+    Window transient;
+    /* WM_NORMAL_HINTS, flags is 0 when the property is missing */
+    long hint_flags;
+    int min_w, min_h, max_w, max_h;
+    int inc_w, inc_h, base_w, base_h;
+    int min_aspect_x, min_aspect_y, max_aspect_x, max_aspect_y;
+    Bool fullscreen;
+    long desktop; /* _NET_WM_DESKTOP, -1 when unset */
+    /* _NET_WM_PID and _NET_STARTUP_ID, only asked for without xcb while a
+     * spawned program has yet to show a window. 0 and "" when unknown */
+    long pid;
+    char startup_id[64];
+    char res_name[64];
+    char res_class[64];
+    /* _NET_WM_NAME, else WM_NAME, only asked for while a window rule
+     * matches on titles */
+    char title[128];
+} win_query_t;
+
+void query_hints(Window w, win_query_t *q);
+void query_windows(const Window *wins, int n, win_query_t *out);
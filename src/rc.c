@@ -0,0 +1,571 @@
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <X11/Xlib.h>
+
+#include "config.h"
+#include "defs.h"
+
+/* runtime config file, read at startup and again whenever it is written.
+ * it lives at $TILITE_CONFIG, else $XDG_CONFIG_HOME/tilite/tiliterc, else
+ * ~/.config/tilite/tiliterc, and overrides the defaults in config.h line by
+ * line:
+ *
+ *   # comment
+ *   gaps = 8
+ *   focused_border_col = #89B4FA
+ *   modkey = alt
+ *   bind = mod+shift+Return : exec alacritty -e htop
+ *   bind = mod+r : restart
+ *   bind = mod+0 : workspace 9
+ *   unbind = mod+w
+ *   autostart = 2 : firefox
+ *   autostart = picom
+ *   rule = class=mpv : floating
+ *   rule = title="Picture-in-Picture" : sticky geometry 640x360+1260+700
+ *   rule = class=firefox type=dialog : workspace 2 nofocus
+ *
+ * a rule matches on any of class, instance, title (anywhere in it) and type
+ * (dialog, utility, splash, ...), a value with spaces goes in quotes. its
+ * actions are workspace N, floating, fullscreen, sticky, nofocus and
+ * geometry WxH+X+Y, relative to the window's monitor. rules from the file
+ * come after the config.h ones, and later rules win.
+ *
+ * "mod" in a key combo is whatever modkey ends up as, as is MODKEY in the
+ * compiled in bindings. a file that does not parse is reported and the
+ * running config is kept. */
+
+#define RC_LINE_SIZE 512
+#define RC_MOD (1 << 15) /* not a real modifier bit */
+
+typedef enum { RC_INT, RC_BOOL, RC_COL } rc_kind_t;
+
+typedef struct {
+    const char *name;
+    size_t offset;
+    rc_kind_t kind;
+} rc_option_t;
+
+typedef struct {
+    Bool unbind;
+    binding_t bind;
+} rc_bind_t;
+
+static const rc_option_t options[] = {
+    {"border_width", offsetof(config_t, border_width), RC_INT},
+    {"floating_on_top", offsetof(config_t, floating_on_top), RC_BOOL},
+    {"focused_border_col", offsetof(config_t, border_foc_col), RC_COL},
+    {"fullscreen_hide", offsetof(config_t, fullscreen_hide), RC_INT},
+    {"gaps", offsetof(config_t, gaps), RC_INT},
+    {"monocle_hide", offsetof(config_t, monocle_hide), RC_INT},
+    {"motion_throttle", offsetof(config_t, motion_throttle), RC_INT},
+    {"move_window_amt", offsetof(config_t, move_window_amt), RC_INT},
+    {"new_win_focus", offsetof(config_t, new_win_focus), RC_BOOL},
+    {"resize_window_amt", offsetof(config_t, resize_window_amt), RC_INT},
+    {"snap_distance", offsetof(config_t, snap_distance), RC_INT},
+    {"swap_border_col", offsetof(config_t, border_swap_col), RC_COL},
+    {"unfocused_border_col", offsetof(config_t, border_ufoc_col), RC_COL},
+    {"warp_cursor", offsetof(config_t, warp_cursor), RC_BOOL},
+};
+
+static const command_t commands[] = {
+    {"close_focused", close_focused},
+    {"focus_down", focus_down},
+    {"focus_left", focus_left},
+    {"focus_right", focus_right},
+    {"focus_up", focus_up},
+    {"move_focused_down", move_focused_down},
+    {"move_focused_left", move_focused_left},
+    {"move_focused_right", move_focused_right},
+    {"move_focused_up", move_focused_up},
+    {"move_win_down", move_win_down},
+    {"move_win_left", move_win_left},
+    {"move_win_right", move_win_right},
+    {"move_win_up", move_win_up},
+    {"quit", quit},
+    {"resize_win_down", resize_win_down},
+    {"resize_win_left", resize_win_left},
+    {"resize_win_right", resize_win_right},
+    {"resize_win_up", resize_win_up},
+    {"restart", restart},
+    {"toggle_floating", toggle_floating},
+    {"toggle_floating_global", toggle_floating_global},
+    {"toggle_fullscreen", toggle_fullscreen},
+    {"toggle_monocle", toggle_monocle},
+};
+
+static char rc_path[PATH_MAX];
+static const char *rc_name = "";
+static int rc_fd = -1;
+static rc_bind_t file_binds[MAX_ITEMS];
+static config_t next_config;
+
+static char *trim(char *s) {
+    while (*s == ' ' || *s == '\t')
+        s++;
+    char *end = s + strlen(s);
+    while (end > s && (end[-1] == ' ' || end[-1] == '\t' ||
+                       end[-1] == '\n' || end[-1] == '\r'))
+        *--end = '\0';
+    return s;
+}
+
+static void free_cmds(binding_t *binds, int n) {
+    for (int i = 0; i < n; i++)
+        if (binds[i].type == TYPE_CMD)
+            free_pipeline(binds[i].action.cmd);
+}
+
+static void free_to_run(config_t *cfg) {
+    for (int i = 0; i < cfg->n_to_run; i++)
+        free_pipeline(cfg->to_run[i].cmd);
+    cfg->n_to_run = 0;
+}
+
+static Bool parse_int(const char *s, int *out) {
+    char *end;
+    long v = strtol(s, &end, 10);
+    if (end == s || *end || v < 0 || v > INT_MAX)
+        return False;
+    *out = (int)v;
+    return True;
+}
+
+static Bool parse_bool(const char *s, Bool *out) {
+    if (strcmp(s, "true") == 0 || strcmp(s, "yes") == 0 ||
+        strcmp(s, "1") == 0)
+        *out = True;
+    else if (strcmp(s, "false") == 0 || strcmp(s, "no") == 0 ||
+             strcmp(s, "0") == 0)
+        *out = False;
+    else
+        return False;
+    return True;
+}
+
+static Bool parse_colour(const char *s, long *out) {
+    XColor col;
+    if (!XParseColor(dpy, DefaultColormap(dpy, DefaultScreen(dpy)), s, &col))
+        return False;
+    *out = parse_col(s);
+    return True;
+}
+
+static int parse_mod(const char *s) {
+    if (strcmp(s, "mod") == 0)
+        return RC_MOD;
+    if (strcmp(s, "super") == 0 || strcmp(s, "mod4") == 0)
+        return Mod4Mask;
+    if (strcmp(s, "alt") == 0 || strcmp(s, "mod1") == 0)
+        return Mod1Mask;
+    if (strcmp(s, "ctrl") == 0 || strcmp(s, "control") == 0)
+        return ControlMask;
+    if (strcmp(s, "shift") == 0)
+        return ShiftMask;
+    return 0;
+}
+
+/* "mod+shift+Return" */
+static Bool parse_combo(char *s, binding_t *bind) {
+    bind->mods = 0;
+    for (char *plus; (plus = strchr(s, '+')) && plus[1];) {
+        *plus = '\0';
+        int mod = parse_mod(trim(s));
+        if (!mod)
+            return False;
+        bind->mods |= mod;
+        s = plus + 1;
+    }
+    bind->keysym = XStringToKeysym(trim(s));
+    return bind->keysym != NoSymbol;
+}
+
+/* cuts the next blank separated word off *s, "quoted" parts may hold
+ * blanks. NULL once there are no words left */
+static char *next_word(char **s) {
+    char *p = *s + strspn(*s, " \t");
+    if (!*p)
+        return NULL;
+
+    char *word = p, *out = p;
+    Bool quoted = False;
+    for (; *p && (quoted || (*p != ' ' && *p != '\t')); p++) {
+        if (*p == '"')
+            quoted = !quoted;
+        else
+            *out++ = *p;
+    }
+    *s = *p ? p + 1 : p;
+    *out = '\0';
+    return word;
+}
+
+/* "class=firefox title=\"some title\"" */
+static const char *parse_rule_match(char *s, rule_t *r) {
+    static const struct {
+        const char *name;
+        size_t offset;
+    } fields[] = {
+        {"class", offsetof(rule_t, class)},
+        {"instance", offsetof(rule_t, instance)},
+        {"title", offsetof(rule_t, title)},
+        {"type", offsetof(rule_t, type)},
+    };
+
+    int n = 0;
+    for (char *word; (word = next_word(&s)); n++) {
+        char *eq = strchr(word, '=');
+        if (!eq || !eq[1])
+            return "expected field=value";
+        *eq = '\0';
+        size_t i = 0;
+        while (i < sizeof(fields) / sizeof(fields[0]) &&
+               strcmp(word, fields[i].name) != 0)
+            i++;
+        if (i == sizeof(fields) / sizeof(fields[0]))
+            return "unknown rule field";
+        if (strlen(eq + 1) >= RULE_STR_SIZE)
+            return "rule value too long";
+        strcpy((char *)r + fields[i].offset, eq + 1);
+    }
+    return n ? NULL : "a rule needs something to match";
+}
+
+/* "workspace 2 floating geometry 640x360+10+10" */
+static const char *parse_rule_action(char *s, rule_action_t *a) {
+    int n = 0;
+    for (char *word; (word = next_word(&s)); n++) {
+        if (strcmp(word, "floating") == 0) {
+            a->floating = True;
+        } else if (strcmp(word, "fullscreen") == 0) {
+            a->fullscreen = True;
+        } else if (strcmp(word, "sticky") == 0) {
+            a->sticky = True;
+        } else if (strcmp(word, "nofocus") == 0) {
+            a->no_focus = True;
+        } else if (strcmp(word, "workspace") == 0) {
+            char *arg = next_word(&s);
+            if (!arg || !parse_int(arg, &a->ws) || a->ws < 1 ||
+                a->ws > NUM_WORKSPACES)
+                return "bad workspace";
+            a->ws--;
+        } else if (strcmp(word, "geometry") == 0) {
+            char *arg = next_word(&s);
+            int end = 0;
+            if (!arg || sscanf(arg, "%dx%d+%d+%d%n", &a->w, &a->h, &a->x,
+                               &a->y, &end) != 4 ||
+                arg[end] || a->w <= 0 || a->h <= 0)
+                return "expected geometry WxH+X+Y";
+        } else {
+            return "unknown rule action";
+        }
+    }
+    return n ? NULL : "a rule needs an action";
+}
+
+static Bool parse_action(char *s, binding_t *bind) {
+    int ws;
+    if (strncmp(s, "exec ", 5) == 0) {
+        bind->type = TYPE_CMD;
+        bind->action.cmd = build_pipeline(trim(s + 5));
+        return bind->action.cmd != NULL;
+    }
+    if (strncmp(s, "workspace ", 10) == 0) {
+        bind->type = TYPE_WS_CHANGE;
+        if (!parse_int(trim(s + 10), &ws) || ws < 1 || ws > NUM_WORKSPACES)
+            return False;
+        bind->action.ws = ws - 1;
+        return True;
+    }
+    if (strncmp(s, "move_to_workspace ", 18) == 0) {
+        bind->type = TYPE_WS_MOVE;
+        if (!parse_int(trim(s + 18), &ws) || ws < 1 || ws > NUM_WORKSPACES)
+            return False;
+        bind->action.ws = ws - 1;
+        return True;
+    }
+    for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+        if (strcmp(s, commands[i].name) == 0) {
+            bind->type = TYPE_FUNC;
+            bind->action.fn = commands[i].fn;
+            return True;
+        }
+    }
+    return False;
+}
+
+static const char *parse_line(char *line, config_t *cfg, int *n_file) {
+    char *eq = strchr(line, '=');
+    if (!eq)
+        return "expected key = value";
+    *eq = '\0';
+    char *key = trim(line);
+    char *val = trim(eq + 1);
+
+    if (strcmp(key, "bind") == 0 || strcmp(key, "unbind") == 0) {
+        if (*n_file == MAX_ITEMS)
+            return "too many bindings";
+        rc_bind_t *fb = &file_binds[*n_file];
+        memset(fb, 0, sizeof(*fb));
+        fb->unbind = key[0] == 'u';
+
+        char *colon = fb->unbind ? NULL : strchr(val, ':');
+        if (colon)
+            *colon = '\0';
+        if (!parse_combo(val, &fb->bind))
+            return "bad key combo";
+        if (!fb->unbind) {
+            if (!colon)
+                return "expected combo : action";
+            Bool ok = parse_action(trim(colon + 1), &fb->bind);
+            if (!ok) {
+                free_cmds(&fb->bind, 1);
+                return "unknown action";
+            }
+        }
+        (*n_file)++;
+        return NULL;
+    }
+
+    /* autostart = [workspace :] command, added after the config.h ones */
+    if (strcmp(key, "autostart") == 0) {
+        if (cfg->n_to_run == MAX_ITEMS)
+            return "too many autostart entries";
+        int ws = 0;
+        char *colon = strchr(val, ':');
+        if (colon && colon > val &&
+            strspn(val, "0123456789 \t") == (size_t)(colon - val)) {
+            *colon = '\0';
+            if (!parse_int(trim(val), &ws) || ws < 1 || ws > NUM_WORKSPACES)
+                return "bad workspace";
+            val = trim(colon + 1);
+        }
+        pipeline_t *p = build_pipeline(val);
+        if (!p)
+            return "expected a command";
+        cfg->to_run[cfg->n_to_run++] = (autostart_t){p, ws - 1};
+        return NULL;
+    }
+
+    /* rule = field=value ... : action ... */
+    if (strcmp(key, "rule") == 0) {
+        if (cfg->n_rules == MAX_ITEMS)
+            return "too many rules";
+        rule_t *r = &cfg->rules[cfg->n_rules];
+        memset(r, 0, sizeof(*r));
+        r->action.ws = -1;
+
+        /* the first colon outside quotes ends the match */
+        char *colon = NULL;
+        Bool quoted = False;
+        for (char *p = val; *p && !colon; p++) {
+            if (*p == '"')
+                quoted = !quoted;
+            else if (*p == ':' && !quoted)
+                colon = p;
+        }
+        if (!colon)
+            return "expected match : actions";
+        *colon = '\0';
+        const char *err = parse_rule_match(val, r);
+        if (!err)
+            err = parse_rule_action(colon + 1, &r->action);
+        if (!err)
+            cfg->n_rules++;
+        return err;
+    }
+
+    if (strcmp(key, "modkey") == 0) {
+        int mod = parse_mod(val);
+        if (!mod || mod == RC_MOD)
+            return "modkey must be super, alt, ctrl or shift";
+        cfg->modkey = mod;
+        return NULL;
+    }
+
+    for (size_t i = 0; i < sizeof(options) / sizeof(options[0]); i++) {
+        const rc_option_t *opt = &options[i];
+        if (strcmp(key, opt->name) != 0)
+            continue;
+        char *field = (char *)cfg + opt->offset;
+        switch (opt->kind) {
+        case RC_INT:
+            return parse_int(val, (int *)field) ? NULL : "expected a number";
+        case RC_BOOL:
+            return parse_bool(val, (Bool *)field) ? NULL
+                                                  : "expected true or false";
+        case RC_COL:
+            return parse_colour(val, (long *)field) ? NULL : "bad colour";
+        }
+    }
+    return "unknown option";
+}
+
+/* folds the file's bindings into the defaults, in file order */
+static const char *merge_binds(config_t *cfg, int n_file) {
+    if (cfg->modkey != MODKEY) {
+        for (int i = 0; i < cfg->n_binds; i++) {
+            binding_t *b = &cfg->binds[i];
+            if (b->mods & MODKEY)
+                b->mods = (b->mods & ~MODKEY) | cfg->modkey;
+        }
+    }
+
+    for (int i = 0; i < n_file; i++) {
+        rc_bind_t *fb = &file_binds[i];
+        if (fb->bind.mods & RC_MOD)
+            fb->bind.mods = (fb->bind.mods & ~RC_MOD) | cfg->modkey;
+
+        int at = -1;
+        for (int j = 0; j < cfg->n_binds && at < 0; j++)
+            if (cfg->binds[j].mods == fb->bind.mods &&
+                cfg->binds[j].keysym == fb->bind.keysym)
+                at = j;
+
+        if (at >= 0)
+            free_cmds(&cfg->binds[at], 1);
+        if (fb->unbind) {
+            if (at >= 0) {
+                memmove(&cfg->binds[at], &cfg->binds[at + 1],
+                        (cfg->n_binds - at - 1) * sizeof(binding_t));
+                cfg->n_binds--;
+            }
+        } else if (at >= 0) {
+            cfg->binds[at] = fb->bind;
+        } else if (cfg->n_binds < MAX_ITEMS) {
+            cfg->binds[cfg->n_binds++] = fb->bind;
+        } else {
+            for (; i < n_file; i++)
+                free_cmds(&file_binds[i].bind, 1);
+            return "too many bindings";
+        }
+        fb->bind.type = TYPE_FUNC; /* now owned by cfg */
+    }
+    return NULL;
+}
+
+/* fills cfg from the defaults and the file, -1 if there is nothing usable */
+static int rc_read(config_t *cfg) {
+    FILE *f = fopen(rc_path, "r");
+    if (!f) {
+        if (errno != ENOENT)
+            fprintf(stderr, "tilite: cannot read %s\n", rc_path);
+        return -1;
+    }
+
+    load_config(cfg);
+    char line[RC_LINE_SIZE];
+    const char *err = NULL;
+    int n_file = 0, lineno = 0;
+
+    while (!err && fgets(line, sizeof(line), f)) {
+        lineno++;
+        char *s = trim(line);
+        if (*s && *s != '#')
+            err = parse_line(s, cfg, &n_file);
+    }
+    fclose(f);
+
+    if (!err) {
+        err = merge_binds(cfg, n_file);
+        lineno = 0;
+    } else {
+        for (int i = 0; i < n_file; i++)
+            free_cmds(&file_binds[i].bind, 1);
+    }
+    if (err) {
+        fprintf(stderr, "tilite: %s:%d: %s, keeping the old config\n",
+                rc_path, lineno, err);
+        free_cmds(cfg->binds, cfg->n_binds);
+        free_to_run(cfg);
+        return -1;
+    }
+    return 0;
+}
+
+void rc_cleanup(void) {
+    if (rc_fd >= 0) {
+        close(rc_fd);
+        rc_fd = -1;
+    }
+}
+
+void rc_dispatch(struct pollfd *pfd) {
+    if (!(pfd->revents & POLLIN))
+        return;
+
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    Bool changed = False;
+    ssize_t len;
+
+    while ((len = read(rc_fd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + len;) {
+            struct inotify_event *ev = (struct inotify_event *)p;
+            if (ev->len && strcmp(ev->name, rc_name) == 0)
+                changed = True;
+            p += sizeof(struct inotify_event) + ev->len;
+        }
+    }
+    if (changed)
+        rc_reload();
+}
+
+void rc_init(void) {
+#ifdef TILITE_REPLAY
+    /* a replay runs on the compiled in defaults only */
+    return;
+#endif
+    const char *env = getenv("TILITE_CONFIG");
+    const char *xdg = getenv("XDG_CONFIG_HOME");
+    const char *home = getenv("HOME");
+    if (env && *env)
+        snprintf(rc_path, sizeof(rc_path), "%s", env);
+    else if (xdg && *xdg)
+        snprintf(rc_path, sizeof(rc_path), "%s/tilite/tiliterc", xdg);
+    else if (home && *home)
+        snprintf(rc_path, sizeof(rc_path), "%s/.config/tilite/tiliterc",
+                 home);
+    else
+        return;
+
+    if (rc_read(&next_config) == 0) {
+        free_cmds(user_config.binds, user_config.n_binds);
+        free_to_run(&user_config);
+        user_config = next_config;
+    }
+
+    /* editors often save by renaming over the file, so watch its directory */
+    char dir[PATH_MAX] = ".";
+    const char *slash = strrchr(rc_path, '/');
+    rc_name = slash ? slash + 1 : rc_path;
+    if (slash)
+        snprintf(dir, sizeof(dir), "%.*s",
+                 slash == rc_path ? 1 : (int)(slash - rc_path), rc_path);
+
+    rc_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (rc_fd < 0)
+        return;
+    if (inotify_add_watch(rc_fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+        rc_cleanup();
+}
+
+int rc_pollfd(struct pollfd *pfd) {
+    if (rc_fd < 0)
+        return 0;
+    *pfd = (struct pollfd){.fd = rc_fd, .events = POLLIN};
+    return 1;
+}
+
+int rc_reload(void) {
+    if (!*rc_path || rc_read(&next_config) < 0)
+        return -1;
+    apply_config(&next_config);
+    return 0;
+}
@@ -0,0 +1,428 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/Xinerama.h>
+
+#include "defs.h"
+#include "record.h"
+
+/* event recorder for tilite-replay. the file is a header followed by a stream
+ * of records (see record.h). everything the replayer's mock display needs to
+ * answer the handlers' queries is captured as it is first seen: window
+ * attributes, every small property, atom names, the keyboard and modifier
+ * maps, the outputs. after that only changes are written, so a trace stays
+ * compact. */
+
+typedef struct {
+    unsigned long *slots;
+    size_t cap;
+    size_t len;
+} id_set_t;
+
+static FILE *rec = NULL;
+static uint64_t t0 = 0;
+static id_set_t seen_windows;
+static id_set_t seen_atoms;
+static Atom net_wm_state = None;
+
+static Bool set_add(id_set_t *s, unsigned long id);
+
+static Bool set_has(id_set_t *s, unsigned long id) {
+    if (!s->cap)
+        return False;
+    for (size_t i = id & (s->cap - 1);; i = (i + 1) & (s->cap - 1)) {
+        if (s->slots[i] == id)
+            return True;
+        if (!s->slots[i])
+            return False;
+    }
+}
+
+static void set_grow(id_set_t *s) {
+    id_set_t bigger = {calloc(s->cap ? s->cap * 2 : 256, sizeof(unsigned long)),
+                       s->cap ? s->cap * 2 : 256, 0};
+    if (!bigger.slots)
+        return;
+    for (size_t i = 0; i < s->cap; i++)
+        if (s->slots[i])
+            set_add(&bigger, s->slots[i]);
+    free(s->slots);
+    *s = bigger;
+}
+
+/* returns True when id was not in the set yet. ids are never 0 */
+static Bool set_add(id_set_t *s, unsigned long id) {
+    if ((s->len + 1) * 2 > s->cap)
+        set_grow(s);
+    if (!s->cap)
+        return False;
+
+    for (size_t i = id & (s->cap - 1);; i = (i + 1) & (s->cap - 1)) {
+        if (s->slots[i] == id)
+            return False;
+        if (!s->slots[i]) {
+            s->slots[i] = id;
+            s->len++;
+            return True;
+        }
+    }
+}
+
+static void set_del(id_set_t *s, unsigned long id) {
+    if (!set_has(s, id))
+        return;
+
+    /* rebuild, deletes are rare (one per destroyed window) */
+    id_set_t copy = *s;
+    *s = (id_set_t){calloc(copy.cap, sizeof(unsigned long)), copy.cap, 0};
+    if (!s->slots) {
+        *s = copy;
+        return;
+    }
+    for (size_t i = 0; i < copy.cap; i++)
+        if (copy.slots[i] && copy.slots[i] != id)
+            set_add(s, copy.slots[i]);
+    free(copy.slots);
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static void put(const void *p, size_t n) { fwrite(p, 1, n, rec); }
+static void put_u8(uint8_t v) { put(&v, 1); }
+static void put_u16(uint16_t v) { put(&v, 2); }
+static void put_u32(uint32_t v) { put(&v, 4); }
+static void put_i32(int32_t v) { put(&v, 4); }
+static void put_u64(uint64_t v) { put(&v, 8); }
+
+static void put_atom(Atom a) {
+    if (a <= XA_LAST_PREDEFINED || !set_add(&seen_atoms, a))
+        return;
+
+    char *name = XGetAtomName(dpy, a);
+    if (!name)
+        return;
+
+    size_t len = strlen(name);
+    put_u8(REC_ATOM);
+    put_u32(a);
+    put_u16(len);
+    put(name, len);
+    XFree(name);
+}
+
+static void put_prop(Window w, Atom prop) {
+    Atom type;
+    int format;
+    unsigned long n, after;
+    unsigned char *data = NULL;
+
+    if (XGetWindowProperty(dpy, w, prop, 0, REC_MAX_PROP_LONGS, False,
+                           AnyPropertyType, &type, &format, &n, &after,
+                           &data) != Success ||
+        type == None) {
+        put_atom(prop);
+        put_u8(REC_PROP_DEL);
+        put_u32(w);
+        put_u32(prop);
+        return;
+    }
+
+    /* icons and the like are never read by the handlers */
+    if (after) {
+        XFree(data);
+        return;
+    }
+
+    put_atom(prop);
+    put_atom(type);
+    if (type == XA_ATOM)
+        for (unsigned long i = 0; i < n; i++)
+            put_atom(((Atom *)data)[i]);
+
+    put_u8(REC_PROP);
+    put_u32(w);
+    put_u32(prop);
+    put_u32(type);
+    put_u8(format);
+    put_u32(n);
+    for (unsigned long i = 0; i < n; i++) {
+        if (format == 32)
+            put_u32(((unsigned long *)data)[i]);
+        else if (format == 16)
+            put_u16(((unsigned short *)data)[i]);
+        else
+            put_u8(data[i]);
+    }
+    XFree(data);
+}
+
+static Bool put_window(Window w) {
+    XWindowAttributes wa;
+    Window root_ret, parent = None, *kids = NULL;
+    unsigned int n_kids;
+
+    if (!XGetWindowAttributes(dpy, w, &wa)) {
+        put_u8(REC_GONE);
+        put_u32(w);
+        set_del(&seen_windows, w);
+        return False;
+    }
+    if (XQueryTree(dpy, w, &root_ret, &parent, &kids, &n_kids) && kids)
+        XFree(kids);
+
+    put_u8(REC_WINDOW);
+    put_u32(w);
+    put_u32(parent);
+    put_i32(wa.x);
+    put_i32(wa.y);
+    put_i32(wa.width);
+    put_i32(wa.height);
+    put_i32(wa.border_width);
+    put_u8(wa.override_redirect);
+    put_u8(wa.map_state);
+    return True;
+}
+
+static void put_window_full(Window w) {
+    set_add(&seen_windows, w);
+    if (!put_window(w))
+        return;
+
+    int n_props = 0;
+    Atom *props = XListProperties(dpy, w, &n_props);
+    for (int i = 0; i < n_props; i++)
+        put_prop(w, props[i]);
+    if (props)
+        XFree(props);
+}
+
+static void put_keymap(void) {
+    int min, max, per;
+    XDisplayKeycodes(dpy, &min, &max);
+    KeySym *syms = XGetKeyboardMapping(dpy, min, max - min + 1, &per);
+    if (!syms)
+        return;
+
+    put_u8(REC_KEYMAP);
+    put_u8(min);
+    put_u8(max);
+    for (int k = 0; k <= max - min; k++)
+        put_u32(syms[k * per]);
+    XFree(syms);
+
+    XModifierKeymap *mods = XGetModifierMapping(dpy);
+    if (!mods)
+        return;
+
+    put_u8(REC_MODMAP);
+    put_u8(mods->max_keypermod);
+    put(mods->modifiermap, 8 * mods->max_keypermod);
+    XFreeModifiermap(mods);
+}
+
+static size_t event_size(int type) {
+    switch (type) {
+    case KeyPress:
+    case KeyRelease:
+        return sizeof(XKeyEvent);
+    case ButtonPress:
+    case ButtonRelease:
+        return sizeof(XButtonEvent);
+    case MotionNotify:
+        return sizeof(XMotionEvent);
+    case EnterNotify:
+    case LeaveNotify:
+        return sizeof(XCrossingEvent);
+    case FocusIn:
+    case FocusOut:
+        return sizeof(XFocusChangeEvent);
+    case Expose:
+        return sizeof(XExposeEvent);
+    case CreateNotify:
+        return sizeof(XCreateWindowEvent);
+    case DestroyNotify:
+        return sizeof(XDestroyWindowEvent);
+    case UnmapNotify:
+        return sizeof(XUnmapEvent);
+    case MapNotify:
+        return sizeof(XMapEvent);
+    case MapRequest:
+        return sizeof(XMapRequestEvent);
+    case ReparentNotify:
+        return sizeof(XReparentEvent);
+    case ConfigureNotify:
+        return sizeof(XConfigureEvent);
+    case ConfigureRequest:
+        return sizeof(XConfigureRequestEvent);
+    case PropertyNotify:
+        return sizeof(XPropertyEvent);
+    case ClientMessage:
+        return sizeof(XClientMessageEvent);
+    case MappingNotify:
+        return sizeof(XMappingEvent);
+    default:
+        return sizeof(XEvent);
+    }
+}
+
+/* the window whose server side state the handler for this event reads */
+static Window event_window(XEvent *xev) {
+    switch (xev->type) {
+    case MapRequest:
+        return xev->xmaprequest.window;
+    case ConfigureRequest:
+        return xev->xconfigurerequest.window;
+    case CreateNotify:
+        return xev->xcreatewindow.window;
+    case DestroyNotify:
+        return xev->xdestroywindow.window;
+    case UnmapNotify:
+        return xev->xunmap.window;
+    case MapNotify:
+        return xev->xmap.window;
+    case ReparentNotify:
+        return xev->xreparent.window;
+    case ConfigureNotify:
+        return xev->xconfigure.window;
+    case ButtonPress:
+    case ButtonRelease:
+        return xev->xbutton.subwindow ? xev->xbutton.subwindow
+                                      : xev->xbutton.window;
+    default:
+        return xev->xany.window;
+    }
+}
+
+void record_close(void) {
+    if (!rec)
+        return;
+
+    fclose(rec);
+    rec = NULL;
+    free(seen_windows.slots);
+    free(seen_atoms.slots);
+    seen_windows = (id_set_t){0};
+    seen_atoms = (id_set_t){0};
+}
+
+void record_event(XEvent *xev) {
+    if (!rec)
+        return;
+
+    Window w = event_window(xev);
+    switch (xev->type) {
+    case MapRequest:
+    case CreateNotify:
+        put_window_full(w);
+        break;
+    case DestroyNotify:
+        put_u8(REC_GONE);
+        put_u32(w);
+        set_del(&seen_windows, w);
+        break;
+    case MapNotify:
+    case UnmapNotify:
+    case ReparentNotify:
+        if (set_has(&seen_windows, w))
+            put_window(w);
+        else
+            put_window_full(w);
+        break;
+    case PropertyNotify:
+        if (set_has(&seen_windows, w))
+            put_prop(w, xev->xproperty.atom);
+        else
+            put_window_full(w);
+        put_atom(xev->xproperty.atom);
+        break;
+    case ClientMessage:
+        put_atom(xev->xclient.message_type);
+        if (xev->xclient.message_type == net_wm_state)
+            for (int i = 1; i < 3; i++)
+                put_atom(xev->xclient.data.l[i]);
+        /* fall through */
+    default:
+        if (w && !set_has(&seen_windows, w))
+            put_window_full(w);
+        break;
+    }
+
+    if (xev->type == MappingNotify)
+        put_keymap();
+
+    size_t size = event_size(xev->type);
+    put_u8(REC_EVENT);
+    put_u64(now_ns() - t0);
+    put_u16(size);
+    put(xev, size);
+}
+
+void record_flush(void) {
+    if (rec)
+        fflush(rec);
+}
+
+int record_open(const char *path) {
+    rec = fopen(path, "wb");
+    if (!rec)
+        return -1;
+
+    t0 = now_ns();
+    net_wm_state = XInternAtom(dpy, "_NET_WM_STATE", False);
+    put(REC_MAGIC, 4);
+    put_u32(REC_VERSION);
+    put_u8(sizeof(long));
+    put_u32(root);
+    put_u32(XDisplayWidth(dpy, DefaultScreen(dpy)));
+    put_u32(XDisplayHeight(dpy, DefaultScreen(dpy)));
+
+    put_keymap();
+    record_screens();
+
+    /* the tree as it is right now, replay adopts it like a restart would */
+    put_window_full(root);
+
+    Window root_ret, parent;
+    Window *kids = NULL;
+    unsigned int n_kids = 0;
+    if (XQueryTree(dpy, root, &root_ret, &parent, &kids, &n_kids)) {
+        for (unsigned int i = 0; i < n_kids; i++)
+            put_window_full(kids[i]);
+        if (kids)
+            XFree(kids);
+    }
+
+    fflush(rec);
+    return 0;
+}
+
+/* the outputs as xinerama has them now, called after every randr change */
+void record_screens(void) {
+    if (!rec)
+        return;
+
+    int n = 0;
+    XineramaScreenInfo *info =
+        XineramaIsActive(dpy) ? XineramaQueryScreens(dpy, &n) : NULL;
+    n = info ? MIN(n, 255) : 0;
+    put_u8(REC_SCREENS);
+    put_u8(n);
+    for (int i = 0; i < n; i++) {
+        put_i32(info[i].x_org);
+        put_i32(info[i].y_org);
+        put_i32(info[i].width);
+        put_i32(info[i].height);
+    }
+    if (info)
+        XFree(info);
+}
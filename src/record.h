@@ -0,0 +1,43 @@
+#pragma once
+
+/* on-disk format shared by the recorder (tilite -r) and tilite-replay. all
+ * fields are host endian, the header carries sizeof(long) so a trace is only
+ * replayed on the kind of machine it was taken on.
+ *
+ *   header: "TLRC" u32 version, u8 sizeof(long), u32 root, u32 width,
+ *           u32 height
+ *
+ *   REC_ATOM     u32 atom, u16 len, name
+ *   REC_WINDOW   u32 win, u32 parent, i32 x, y, w, h, border, u8 override,
+ *                u8 map_state
+ *   REC_GONE     u32 win
+ *   REC_PROP     u32 win, u32 prop, u32 type, u8 format, u32 n, n items of
+ *                format / 8 bytes each (format 32 items are stored as u32)
+ *   REC_PROP_DEL u32 win, u32 prop
+ *   REC_KEYMAP   u8 min keycode, u8 max keycode, u32 keysym per keycode
+ *   REC_MODMAP   u8 max_keypermod, 8 * max_keypermod keycodes
+ *   REC_SCREENS  u8 n, n * i32 x, y, w, h: the xinerama outputs, written at
+ *                the start and after every randr change. randr events are
+ *                not replayable themselves, one of these mid-trace stands in
+ *                for them
+ *   REC_EVENT    u64 ns since start, u16 size, the first size bytes of the
+ *                XEvent
+ *
+ * atoms above XA_LAST_PREDEFINED are server specific, every one that shows up
+ * in a later record is named by a REC_ATOM first. */
+
+#define REC_MAGIC "TLRC"
+#define REC_VERSION 2
+#define REC_MAX_PROP_LONGS 1024
+
+enum {
+    REC_ATOM = 1,
+    REC_WINDOW,
+    REC_GONE,
+    REC_PROP,
+    REC_PROP_DEL,
+    REC_KEYMAP,
+    REC_MODMAP,
+    REC_EVENT,
+    REC_SCREENS
+};
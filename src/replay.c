@@ -0,0 +1,365 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+
+#include "defs.h"
+#include "mockx.h"
+#include "record.h"
+
+/* tilite-replay: feeds a trace taken with `tilite -r` through the real
+ * handlers against the mock display in mockx.c and reports how much work
+ * they did. two builds replaying the same trace can be compared directly. */
+
+typedef struct {
+    unsigned long count;
+    unsigned long requests;
+    unsigned long roundtrips;
+    uint64_t ns;
+} replay_slot_t;
+
+typedef struct {
+    uint32_t from;
+    Atom to;
+} atom_map_t;
+
+static FILE *in = NULL;
+static Bool truncated = False;
+static atom_map_t *amap = NULL;
+static size_t n_amap = 0, cap_amap = 0;
+static replay_slot_t slots[LASTEvent];
+static replay_slot_t screen_slot; /* randr changes, see REC_SCREENS */
+
+static void get(void *p, size_t n) {
+    if (fread(p, 1, n, in) != n) {
+        memset(p, 0, n);
+        truncated = True;
+    }
+}
+
+static uint8_t get_u8(void) {
+    uint8_t v;
+    get(&v, 1);
+    return v;
+}
+
+static uint16_t get_u16(void) {
+    uint16_t v;
+    get(&v, 2);
+    return v;
+}
+
+static uint32_t get_u32(void) {
+    uint32_t v;
+    get(&v, 4);
+    return v;
+}
+
+static int32_t get_i32(void) {
+    int32_t v;
+    get(&v, 4);
+    return v;
+}
+
+static uint64_t get_u64(void) {
+    uint64_t v;
+    get(&v, 8);
+    return v;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static Atom map_atom(unsigned long a) {
+    if (a <= XA_LAST_PREDEFINED)
+        return a;
+    for (size_t i = 0; i < n_amap; i++)
+        if (amap[i].from == a)
+            return amap[i].to;
+    return a;
+}
+
+static void add_atom(uint32_t from, const char *name) {
+    if (n_amap == cap_amap) {
+        cap_amap = cap_amap ? cap_amap * 2 : 128;
+        amap = realloc(amap, cap_amap * sizeof(*amap));
+        if (!amap) {
+            fprintf(stderr, "tilite-replay: out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    amap[n_amap++] = (atom_map_t){from, mock_intern(name)};
+}
+
+static void read_prop(void) {
+    Window w = get_u32();
+    Atom prop = map_atom(get_u32());
+    Atom type = map_atom(get_u32());
+    int format = get_u8();
+    unsigned long n = get_u32();
+
+    if (format != 8 && format != 16 && format != 32) {
+        truncated = True;
+        return;
+    }
+
+    void *data = calloc(n + 1, format == 32 ? sizeof(long) : (size_t)format / 8);
+    if (!data) {
+        truncated = True;
+        return;
+    }
+
+    for (unsigned long i = 0; i < n; i++) {
+        if (format == 32) {
+            unsigned long v = get_u32();
+            ((long *)data)[i] = type == XA_ATOM ? map_atom(v) : v;
+        } else if (format == 16) {
+            ((short *)data)[i] = get_u16();
+        } else {
+            ((char *)data)[i] = get_u8();
+        }
+    }
+
+    mock_prop_set(w, prop, type, format, n, data);
+    free(data);
+}
+
+static void read_keymap(void) {
+    int min = get_u8();
+    int max = get_u8();
+    KeySym syms[256] = {0};
+    for (int k = min; k <= max; k++)
+        syms[k - min] = get_u32();
+    mock_keymap(min, max, syms);
+}
+
+static void read_modmap(void) {
+    int per = get_u8();
+    KeyCode codes[8 * 255];
+    get(codes, 8 * per);
+    mock_modmap(per, codes);
+}
+
+static void read_screens(void) {
+    int n = get_u8();
+    int rects[255][4];
+    for (int i = 0; i < n; i++)
+        for (int k = 0; k < 4; k++)
+            rects[i][k] = get_i32();
+    mock_screens(n, (const int(*)[4])rects);
+}
+
+/* applies records to the mock until the next event, which is returned in
+ * xev. returns REC_EVENT for one, REC_SCREENS once the outputs changed
+ * after setup, and 0 at the end of the trace */
+static int next_event(XEvent *xev, uint64_t *ts) {
+    int kind;
+
+    while (!truncated && (kind = fgetc(in)) != EOF) {
+        switch (kind) {
+        case REC_ATOM: {
+            uint32_t a = get_u32();
+            uint16_t len = get_u16();
+            char name[65536];
+            get(name, len);
+            name[len] = '\0';
+            add_atom(a, name);
+            break;
+        }
+        case REC_WINDOW: {
+            Window w = get_u32();
+            Window parent = get_u32();
+            int x = get_i32(), y = get_i32();
+            int width = get_i32(), height = get_i32();
+            int border = get_i32();
+            Bool override_redirect = get_u8();
+            int map_state = get_u8();
+            mock_window(w, parent, x, y, width, height, border,
+                        override_redirect, map_state);
+            break;
+        }
+        case REC_GONE:
+            mock_window_gone(get_u32());
+            break;
+        case REC_PROP:
+            read_prop();
+            break;
+        case REC_PROP_DEL: {
+            Window w = get_u32();
+            mock_prop_del(w, map_atom(get_u32()));
+            break;
+        }
+        case REC_KEYMAP:
+            read_keymap();
+            break;
+        case REC_MODMAP:
+            read_modmap();
+            break;
+        case REC_SCREENS:
+            read_screens();
+            /* the ones in front of the first event are the initial state */
+            if (running && !truncated)
+                return REC_SCREENS;
+            break;
+        case REC_EVENT: {
+            *ts = get_u64();
+            size_t size = get_u16();
+            memset(xev, 0, sizeof(*xev));
+            get(xev, MIN(size, sizeof(*xev)));
+            if (size > sizeof(*xev))
+                fseek(in, size - sizeof(*xev), SEEK_CUR);
+            return truncated ? 0 : REC_EVENT;
+        }
+        default:
+            fprintf(stderr, "tilite-replay: bad record %d\n", kind);
+            truncated = True;
+            break;
+        }
+    }
+    return 0;
+}
+
+/* server specific atoms inside the event itself */
+static void map_event(XEvent *xev) {
+    xev->xany.display = XOpenDisplay(NULL);
+
+    switch (xev->type) {
+    case PropertyNotify:
+        xev->xproperty.atom = map_atom(xev->xproperty.atom);
+        break;
+    case ClientMessage:
+        xev->xclient.message_type = map_atom(xev->xclient.message_type);
+        if (xev->xclient.message_type == mock_intern("_NET_WM_STATE"))
+            for (int i = 1; i < 3; i++)
+                xev->xclient.data.l[i] = map_atom(xev->xclient.data.l[i]);
+        break;
+    case MotionNotify:
+        mock_pointer(xev->xmotion.x_root, xev->xmotion.y_root);
+        break;
+    }
+}
+
+int main(int ac, char **av) {
+    if (ac != 2) {
+        fprintf(stderr, "usage: tilite-replay <trace>\n");
+        return EXIT_FAILURE;
+    }
+
+    in = fopen(av[1], "rb");
+    if (!in) {
+        perror(av[1]);
+        return EXIT_FAILURE;
+    }
+
+    char magic[4];
+    get(magic, 4);
+    uint32_t version = get_u32();
+    uint8_t long_size = get_u8();
+    if (truncated || memcmp(magic, REC_MAGIC, 4) != 0 ||
+        version != REC_VERSION || long_size != sizeof(long)) {
+        fprintf(stderr, "tilite-replay: %s is not a trace for this build\n",
+                av[1]);
+        return EXIT_FAILURE;
+    }
+
+    Window root_win = get_u32();
+    int width = get_u32();
+    int height = get_u32();
+    mock_init(root_win, width, height);
+
+    /* keep the ipc socket and state region of the real wm alone */
+    char sock[64];
+    snprintf(sock, sizeof(sock), "/tmp/tilite-replay-%ld.sock",
+             (long)getpid());
+    setenv("TILITE_SOCKET", sock, 1);
+
+    /* the initial tree has to be in place before setup() adopts it */
+    XEvent xev;
+    uint64_t ts = 0;
+    int kind = next_event(&xev, &ts);
+
+    unsigned long setup_req = mock_requests();
+    setup();
+    setup_req = mock_requests() - setup_req;
+    running = True;
+
+    unsigned long events = 0;
+    uint64_t first_ts = ts, last_ts = ts, total_ns = 0;
+    unsigned long total_req = 0, total_rtt = 0;
+
+    while (kind && running) {
+        replay_slot_t *s = NULL;
+        unsigned long req = mock_requests();
+        unsigned long rtt = mock_roundtrips();
+        uint64_t start = now_ns();
+
+        if (kind == REC_SCREENS) {
+            /* what tilite does for a randr event */
+            update_monitors();
+            s = &screen_slot;
+        } else {
+            map_event(&xev);
+            int type = xev.type;
+            xev_case(&xev);
+            if (type >= 0 && type < LASTEvent)
+                s = &slots[type];
+        }
+
+        uint64_t ns = now_ns() - start;
+        if (s) {
+            s->count++;
+            s->ns += ns;
+            s->requests += mock_requests() - req;
+            s->roundtrips += mock_roundtrips() - rtt;
+        }
+
+        events++;
+        total_ns += ns;
+        total_req += mock_requests() - req;
+        total_rtt += mock_roundtrips() - rtt;
+        last_ts = ts;
+
+        if (running)
+            shm_update();
+        kind = next_event(&xev, &ts);
+    }
+
+    if (running)
+        quit();
+
+    if (truncated)
+        fprintf(stderr, "tilite-replay: trace ends mid-record\n");
+
+    printf("trace %s\n", av[1]);
+    printf("events %lu\n", events);
+    printf("recorded_ms %.3f\n", (last_ts - first_ts) / 1e6);
+    printf("handler_ms %.3f\n", total_ns / 1e6);
+    printf("setup_requests %lu\n", setup_req);
+    printf("requests %lu\n", total_req);
+    printf("roundtrips %lu\n", total_rtt);
+    printf("\n%-18s %8s %12s %10s %10s\n", "event", "count", "handler_us",
+           "requests", "roundtrips");
+    for (int i = 0; i < LASTEvent; i++) {
+        replay_slot_t *s = &slots[i];
+        if (!s->count)
+            continue;
+        printf("%-18s %8lu %12.1f %10lu %10lu\n",
+               event_names[i] ? event_names[i] : "?", s->count, s->ns / 1e3,
+               s->requests, s->roundtrips);
+    }
+    if (screen_slot.count)
+        printf("%-18s %8lu %12.1f %10lu %10lu\n", "RRScreenChange",
+               screen_slot.count, screen_slot.ns / 1e3, screen_slot.requests,
+               screen_slot.roundtrips);
+
+    fclose(in);
+    return truncated ? EXIT_FAILURE : EXIT_SUCCESS;
+}
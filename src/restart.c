@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+
+#include "defs.h"
+#include "layout.h"
+#include "query.h"
+
+/* state handed from a restarting tilite to the one it execs. a stream of
+ * whitespace separated tokens:
+ *
+ *   tilite-restart <version>
+ *   state <current_ws> <monocle> <global_floating> <focused>
+ *   client <win> <ws> <flags> <orig_x> <orig_y> <orig_w> <orig_h> <hidden>
+ *          <bypass>
+ *   tree <ws> <node>...
+ *   wsfocus <ws> <win>
+ *   monitor <m> <ws>
+ *   end
+ *
+ * clients come in list order per workspace. a tree is written preorder, a
+ * split as "v" or "h" followed by its two children, a leaf as its window.
+ * geometry is not kept, the new process asks the server for it, so nothing
+ * has to move when the state comes back. hidden is the COVER_* a window is
+ * put away with, and bypass the client's own _NET_WM_BYPASS_COMPOSITOR (-1
+ * for none) that a fullscreen window gets back when it leaves fullscreen. */
+
+#define RESTART_VERSION 2
+
+enum {
+    RS_FLOATING = 1 << 0,
+    RS_FULLSCREEN = 1 << 1,
+    RS_FIXED = 1 << 2,
+    RS_MAPPED = 1 << 3,
+    RS_STICKY = 1 << 4,
+};
+
+typedef struct {
+    Window win;
+    int ws;
+    int flags;
+    int orig_x, orig_y, orig_w, orig_h;
+    int hidden;
+    long bypass;
+} restart_client_t;
+
+static void save_tree(FILE *f, bsp_node_t *node) {
+    if (!node)
+        return;
+    if (node->type == BSP_LEAF) {
+        fprintf(f, " 0x%lx", node->client ? node->client->win : None);
+        return;
+    }
+    fputs(node->type == BSP_SPLIT_H ? " h" : " v", f);
+    save_tree(f, node->first);
+    save_tree(f, node->second);
+}
+
+/* leaves whose client did not come back are dropped, their split collapses
+ * into the surviving child */
+static bsp_node_t *load_tree(FILE *f, int ws, int depth) {
+    char tok[32];
+    if (depth > 2 * MAX_CLIENTS || fscanf(f, "%31s", tok) != 1)
+        return NULL;
+
+    if (strcmp(tok, "v") == 0 || strcmp(tok, "h") == 0) {
+        bsp_type_t type = tok[0] == 'h' ? BSP_SPLIT_H : BSP_SPLIT_V;
+        bsp_node_t *first = load_tree(f, ws, depth + 1);
+        bsp_node_t *second = load_tree(f, ws, depth + 1);
+        if (!first)
+            return second;
+        if (!second)
+            return first;
+        bsp_node_t *split = bsp_make_split(type, first, second);
+        if (!split) {
+            bsp_free(&first);
+            bsp_free(&second);
+        }
+        return split;
+    }
+
+    client_t *c = find_client(strtoul(tok, NULL, 16));
+    if (!c || c->ws != ws || !c->mapped || c->floating || c->fullscreen)
+        return NULL;
+    return bsp_make_leaf(c);
+}
+
+int restart_load(int fd) {
+    FILE *f = fdopen(fd, "r");
+    if (!f)
+        return -1;
+
+    restart_client_t saved[MAX_CLIENTS];
+    Window wins[MAX_CLIENTS];
+    client_t *restored[MAX_CLIENTS];
+    int n = 0, version = 0, ws = 0, mono = 0, floating = 0;
+    Window focus_win = None;
+    char tok[32];
+
+    if (fscanf(f, "tilite-restart %d", &version) != 1 ||
+        version != RESTART_VERSION ||
+        fscanf(f, " state %d %d %d %lx", &ws, &mono, &floating,
+               &focus_win) != 4 ||
+        ws < 0 || ws >= NUM_WORKSPACES) {
+        fclose(f);
+        return -1;
+    }
+
+    while (fscanf(f, "%31s", tok) == 1 && strcmp(tok, "client") == 0) {
+        restart_client_t rc;
+        if (fscanf(f, "%lx %d %d %d %d %d %d %d %ld", &rc.win, &rc.ws,
+                   &rc.flags, &rc.orig_x, &rc.orig_y, &rc.orig_w, &rc.orig_h,
+                   &rc.hidden, &rc.bypass) != 9) {
+            fclose(f);
+            return -1;
+        }
+        if (n < MAX_CLIENTS && rc.ws >= 0 && rc.ws < NUM_WORKSPACES) {
+            saved[n] = rc;
+            wins[n++] = rc.win;
+        }
+    }
+
+    /* whatever went away while we were gone is skipped */
+    win_query_t qs[MAX_CLIENTS];
+    query_windows(wins, n, qs);
+
+    current_ws = ws;
+    monocle = mono;
+    global_floating = floating;
+    adopting = True;
+    int n_restored = 0;
+    for (int i = 0; i < n; i++) {
+        restart_client_t *rc = &saved[i];
+        if (!qs[i].valid || qs[i].override_redirect || find_client(rc->win))
+            continue;
+        client_t *c = add_client(rc->win, rc->ws, &qs[i]);
+        if (!c)
+            continue;
+        c->floating = (rc->flags & RS_FLOATING) != 0;
+        c->fullscreen = (rc->flags & RS_FULLSCREEN) != 0;
+        c->fixed = (rc->flags & RS_FIXED) != 0;
+        c->mapped = (rc->flags & RS_MAPPED) != 0;
+        c->sticky = (rc->flags & RS_STICKY) != 0;
+        c->orig_x = rc->orig_x;
+        c->orig_y = rc->orig_y;
+        c->orig_w = rc->orig_w;
+        c->orig_h = rc->orig_h;
+        c->hidden = CLAMP(rc->hidden, COVER_SHOW, COVER_UNMAP);
+        c->bypass = rc->bypass;
+        restored[n_restored++] = c;
+    }
+    adopting = False;
+
+    /* add_client links new clients after the focused one, put the lists
+     * back in their saved order */
+    for (int i = 0; i < NUM_WORKSPACES; i++) {
+        workspaces[i] = NULL;
+        bsp_free(&bsp_roots[i]);
+        ws_focused[i] = NULL;
+    }
+    for (int i = n_restored - 1; i >= 0; i--) {
+        client_t *c = restored[i];
+        c->next = workspaces[c->ws];
+        workspaces[c->ws] = c;
+    }
+
+    while (strcmp(tok, "end") != 0) {
+        int tws, m;
+        Window w;
+        if (strcmp(tok, "tree") == 0 && fscanf(f, "%d", &tws) == 1 &&
+            tws >= 0 && tws < NUM_WORKSPACES) {
+            bsp_free(&bsp_roots[tws]);
+            bsp_roots[tws] = load_tree(f, tws, 0);
+        } else if (strcmp(tok, "wsfocus") == 0 &&
+                   fscanf(f, "%d %lx", &tws, &w) == 2 && tws >= 0 &&
+                   tws < NUM_WORKSPACES) {
+            client_t *c = find_client(w);
+            if (c && c->ws == tws)
+                ws_focused[tws] = c;
+        } else if (strcmp(tok, "monitor") == 0 &&
+                   fscanf(f, "%d %d", &m, &tws) == 2) {
+            /* outputs may have gone away across the exec */
+            if (m >= 0 && m < n_monitors && tws >= 0 && tws < NUM_WORKSPACES)
+                monitor_show(m, tws);
+        } else {
+            break;
+        }
+        if (fscanf(f, "%31s", tok) != 1)
+            break;
+    }
+    fclose(f);
+
+    if (!ws_visible(current_ws))
+        monitor_show(ws_mon[current_ws], current_ws);
+
+    /* tiled clients missing from their tree get a leaf of their own */
+    for (int i = 0; i < n_restored; i++) {
+        client_t *c = restored[i];
+        if (c->mapped && !c->floating && !c->fullscreen)
+            bsp_insert(&bsp_roots[c->ws], NULL, c);
+        if (!ws_focused[c->ws] && c->mapped)
+            ws_focused[c->ws] = c;
+    }
+
+    client_t *c = find_client(focus_win);
+    if (!c || c->ws != current_ws || !c->mapped)
+        c = ws_focused[current_ws];
+    focused = c;
+
+    long desktop = current_ws;
+    XChangeProperty(dpy, root, atoms[ATOM_NET_CURRENT_DESKTOP], XA_CARDINAL, 32,
+                    PropModeReplace, (unsigned char *)&desktop, 1);
+    return 0;
+}
+
+int restart_save(FILE *f) {
+    fprintf(f, "tilite-restart %d\n", RESTART_VERSION);
+    fprintf(f, "state %d %d %d 0x%lx\n", current_ws, monocle, global_floating,
+            focused ? focused->win : None);
+
+    for (int ws = 0; ws < NUM_WORKSPACES; ws++) {
+        for (client_t *c = workspaces[ws]; c; c = c->next) {
+            int flags = (c->floating ? RS_FLOATING : 0) |
+                        (c->fullscreen ? RS_FULLSCREEN : 0) |
+                        (c->fixed ? RS_FIXED : 0) |
+                        (c->mapped ? RS_MAPPED : 0) |
+                        (c->sticky ? RS_STICKY : 0);
+            fprintf(f, "client 0x%lx %d %d %d %d %d %d %d %ld\n", c->win, ws,
+                    flags, c->orig_x, c->orig_y, c->orig_w, c->orig_h,
+                    c->hidden, c->bypass);
+        }
+    }
+
+    for (int ws = 0; ws < NUM_WORKSPACES; ws++) {
+        if (bsp_roots[ws]) {
+            fprintf(f, "tree %d", ws);
+            save_tree(f, bsp_roots[ws]);
+            fputc('\n', f);
+        }
+        if (ws_focused[ws])
+            fprintf(f, "wsfocus %d 0x%lx\n", ws, ws_focused[ws]->win);
+    }
+    for (int m = 0; m < n_monitors; m++)
+        fprintf(f, "monitor %d %d\n", m, monitors[m].ws);
+    fputs("end\n", f);
+    return fflush(f) == 0 && !ferror(f) ? 0 : -1;
+}
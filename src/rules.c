@@ -0,0 +1,142 @@
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <X11/Xlib.h>
+
+#include "defs.h"
+#include "query.h"
+
+/* window rules, compiled whenever the config changes. every rule that names
+ * a class or an instance is filed under that name in a hash table, the rest
+ * go in one list of rules that have to be tried on every window. a map then
+ * looks up its class and instance once and only runs the rules that could
+ * match, in config order, so later rules override earlier ones. */
+
+#define RULE_SLOTS (2 * MAX_ITEMS)
+#define RULE_WORDS (MAX_ITEMS / 64)
+
+typedef struct {
+    const char *key; /* NULL for an empty slot */
+    uint64_t rules[RULE_WORDS];
+} rule_slot_t;
+
+static const rule_t *rules;
+static int n_rules;
+static Atom rule_types[MAX_ITEMS];
+static rule_slot_t by_class[RULE_SLOTS];
+static rule_slot_t by_instance[RULE_SLOTS];
+static uint64_t unkeyed[RULE_WORDS];
+static Bool titles; /* some rule looks at the title */
+
+static uint32_t hash_str(const char *s) {
+    uint32_t h = 2166136261u;
+    while (*s)
+        h = (h ^ (unsigned char)*s++) * 16777619u;
+    return h;
+}
+
+/* the slot for key, or the empty slot it would go in */
+static rule_slot_t *slot_for(rule_slot_t *table, const char *key) {
+    uint32_t i = hash_str(key) & (RULE_SLOTS - 1);
+    while (table[i].key && strcmp(table[i].key, key) != 0)
+        i = (i + 1) & (RULE_SLOTS - 1);
+    return &table[i];
+}
+
+static Bool rule_matches(int i, const win_query_t *q) {
+    const rule_t *r = &rules[i];
+    if (*r->class && strcmp(r->class, q->res_class) != 0)
+        return False;
+    if (*r->instance && strcmp(r->instance, q->res_name) != 0)
+        return False;
+    if (*r->title && !strstr(q->title, r->title))
+        return False;
+    if (*r->type) {
+        Bool found = False;
+        for (int t = 0; t < q->n_types && !found; t++)
+            found = q->types[t] == rule_types[i];
+        if (!found)
+            return False;
+    }
+    return True;
+}
+
+/* applies every rule matching q to out, which starts out as no rule */
+void rules_apply(const win_query_t *q, rule_action_t *out) {
+    *out = (rule_action_t){.ws = -1};
+    if (!n_rules)
+        return;
+
+    uint64_t todo[RULE_WORDS];
+    memcpy(todo, unkeyed, sizeof(todo));
+    const rule_slot_t *s = slot_for(by_class, q->res_class);
+    for (int w = 0; s->key && w < RULE_WORDS; w++)
+        todo[w] |= s->rules[w];
+    s = slot_for(by_instance, q->res_name);
+    for (int w = 0; s->key && w < RULE_WORDS; w++)
+        todo[w] |= s->rules[w];
+
+    for (int w = 0; w < RULE_WORDS; w++) {
+        for (uint64_t bits = todo[w]; bits; bits &= bits - 1) {
+            int i = w * 64 + __builtin_ctzll(bits);
+            if (!rule_matches(i, q))
+                continue;
+            const rule_action_t *a = &rules[i].action;
+            if (a->ws >= 0)
+                out->ws = a->ws;
+            out->floating |= a->floating;
+            out->fullscreen |= a->fullscreen;
+            out->sticky |= a->sticky;
+            out->no_focus |= a->no_focus;
+            if (a->w > 0) {
+                out->x = a->x;
+                out->y = a->y;
+                out->w = a->w;
+                out->h = a->h;
+            }
+        }
+    }
+}
+
+/* compiles cfg's rules, which have to stay where they are until the next
+ * call */
+void rules_build(const config_t *cfg) {
+    rules = cfg->rules;
+    n_rules = cfg->n_rules;
+    titles = False;
+    memset(by_class, 0, sizeof(by_class));
+    memset(by_instance, 0, sizeof(by_instance));
+    memset(unkeyed, 0, sizeof(unkeyed));
+
+    for (int i = 0; i < n_rules; i++) {
+        const rule_t *r = &rules[i];
+        uint64_t bit = 1ull << (i % 64);
+
+        /* a rule naming both only needs filing under one of them */
+        if (*r->class || *r->instance) {
+            rule_slot_t *table = *r->class ? by_class : by_instance;
+            const char *key = *r->class ? r->class : r->instance;
+            rule_slot_t *s = slot_for(table, key);
+            s->key = key;
+            s->rules[i / 64] |= bit;
+        } else {
+            unkeyed[i / 64] |= bit;
+        }
+
+        titles |= *r->title != '\0';
+        rule_types[i] = None;
+        if (*r->type) {
+            char name[RULE_STR_SIZE + 32];
+            int n = snprintf(name, sizeof(name), "_NET_WM_WINDOW_TYPE_%s",
+                             r->type);
+            for (int c = 20; c < n; c++)
+                name[c] = toupper((unsigned char)name[c]);
+            rule_types[i] = XInternAtom(dpy, name, False);
+        }
+    }
+}
+
+/* the map path only asks for the title when a rule will look at it */
+Bool rules_need_title(void) { return titles; }
@@ -0,0 +1,125 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <X11/Xlib.h>
+
+#include "defs.h"
+#include "state.h"
+
+static shm_state_t *state = NULL;
+static shm_snapshot_t next;
+static char shm_name[64];
+
+static void build_snapshot(shm_snapshot_t *s) {
+    memset(s, 0, sizeof(*s));
+
+    s->current_ws = current_ws;
+    s->layout = monocle ? SHM_LAYOUT_MONOCLE : SHM_LAYOUT_BSP;
+    s->global_floating = global_floating;
+    s->n_workspaces = MIN(NUM_WORKSPACES, SHM_MAX_WORKSPACES);
+    s->focused = focused ? focused->win : None;
+
+    s->n_monitors = MIN(n_monitors, SHM_MAX_MONITORS);
+    for (uint32_t m = 0; m < s->n_monitors; m++) {
+        shm_monitor_t *sm = &s->monitors[m];
+        sm->x = monitors[m].x;
+        sm->y = monitors[m].y;
+        sm->w = monitors[m].w;
+        sm->h = monitors[m].h;
+        sm->ws = monitors[m].ws;
+    }
+
+    const char names[] = WORKSPACE_NAMES;
+    const char *name = names;
+    for (uint32_t ws = 0; ws < s->n_workspaces; ws++) {
+        size_t len = strlen(name);
+        memcpy(s->ws_names[ws], name, MIN(len, SHM_WS_NAME_LEN - 1));
+        name += len + 1;
+        s->ws_monitor[ws] = ws_mon[ws];
+
+        for (client_t *c = workspaces[ws]; c; c = c->next) {
+            s->ws_clients[ws]++;
+            if (s->n_clients == SHM_MAX_CLIENTS)
+                continue;
+
+            shm_client_t *sc = &s->clients[s->n_clients++];
+            sc->win = c->win;
+            sc->x = c->x;
+            sc->y = c->y;
+            sc->w = c->w;
+            sc->h = c->h;
+            sc->ws = ws;
+            sc->flags = (c->mapped ? SHM_CLIENT_MAPPED : 0) |
+                        (c->floating ? SHM_CLIENT_FLOATING : 0) |
+                        (c->fullscreen ? SHM_CLIENT_FULLSCREEN : 0) |
+                        (c->fixed ? SHM_CLIENT_FIXED : 0) |
+                        (c->sticky ? SHM_CLIENT_STICKY : 0) |
+                        (c->hidden != COVER_SHOW ? SHM_CLIENT_HIDDEN : 0);
+        }
+    }
+}
+
+void shm_cleanup(void) {
+    if (!state)
+        return;
+
+    munmap(state, sizeof(*state));
+    shm_unlink(shm_name);
+    state = NULL;
+}
+
+void shm_init(void) {
+    snprintf(shm_name, sizeof(shm_name), "/tilite%s", DisplayString(dpy));
+    /* shm names may only contain the leading slash */
+    for (char *p = shm_name + 1; *p; p++)
+        if (*p == '/')
+            *p = '_';
+
+    int fd = shm_open(shm_name, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        perror("tilite: shm_open");
+        return;
+    }
+
+    if (ftruncate(fd, sizeof(*state)) < 0) {
+        perror("tilite: ftruncate");
+        close(fd);
+        shm_unlink(shm_name);
+        return;
+    }
+
+    void *map =
+        mmap(NULL, sizeof(*state), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("tilite: mmap");
+        shm_unlink(shm_name);
+        return;
+    }
+
+    state = map;
+    state->magic = SHM_STATE_MAGIC;
+    state->version = SHM_STATE_VERSION;
+    state->size = sizeof(*state);
+    setenv("TILITE_STATE", shm_name, 1);
+    shm_update();
+}
+
+void shm_update(void) {
+    if (!state)
+        return;
+
+    build_snapshot(&next);
+    if (memcmp(&next, &state->snap, sizeof(next)) == 0)
+        return;
+
+    uint32_t seq = state->seq;
+    __atomic_store_n(&state->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(&state->snap, &next, sizeof(next));
+    __atomic_store_n(&state->seq, seq + 2, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,262 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <X11/Xlib.h>
+
+#include "harness.h"
+
+/* tilite-soak: runs tilite under a private Xvfb and churns map, unmap, focus,
+ * workspace switch and destroy operations through a small pool of client
+ * windows. tilite's RSS and its "mem" ipc counters are sampled as it goes.
+ * the run fails when RSS or heap grow past a bound after warmup, or when
+ * clients or bsp nodes are left over once every window is gone. */
+
+#define SOAK_SLOTS 8
+#define SOAK_SYNC_EVERY 256
+
+typedef enum { SLOT_EMPTY, SLOT_MAPPED, SLOT_UNMAPPED } slot_state_t;
+
+typedef struct {
+    long rss_kb;
+    long heap;
+    long clients;
+    long nodes;
+} soak_sample_t;
+
+static Display *dpy;
+static Window root;
+static Atom net_current_desktop;
+static Window slots[SOAK_SLOTS];
+static slot_state_t states[SOAK_SLOTS];
+static int ipc_fd = -1;
+static uint64_t rng = 0x9e3779b97f4a7c15u;
+
+static int ignore_xerror(Display *d, XErrorEvent *ee) {
+    (void)d;
+    (void)ee;
+    return 0;
+}
+
+static unsigned int next_rand(void) {
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return (unsigned int)(rng >> 32);
+}
+
+static void ipc_connect(const char *path) {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+
+    for (int i = 0; i < 500; i++) {
+        ipc_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (ipc_fd < 0)
+            harness_die("socket failed");
+        if (connect(ipc_fd, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+            return;
+        close(ipc_fd);
+        usleep(10000);
+    }
+    harness_die("cannot connect to the wm's ipc socket");
+}
+
+static soak_sample_t sample(void) {
+    soak_sample_t s = {harness_rss_kb(), -1, -1, -1};
+    char line[128];
+    size_t len = 0;
+
+    if (write(ipc_fd, "mem\n", 4) != 4)
+        harness_die("ipc write failed");
+    while (len < sizeof(line) - 1) {
+        ssize_t n = read(ipc_fd, line + len, 1);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            harness_die("ipc read failed");
+        if (line[len] == '\n')
+            break;
+        len++;
+    }
+    line[len] = '\0';
+
+    if (sscanf(line, "mem clients %ld bsp_nodes %ld heap %ld", &s.clients,
+               &s.nodes, &s.heap) != 3)
+        harness_die("unexpected reply to mem");
+    return s;
+}
+
+static void op_map(int i) {
+    if (states[i] == SLOT_EMPTY)
+        slots[i] = XCreateSimpleWindow(dpy, root, 0, 0, 64, 64, 0, 0, 0);
+    XMapWindow(dpy, slots[i]);
+    states[i] = SLOT_MAPPED;
+}
+
+static void op_unmap(int i) {
+    XUnmapWindow(dpy, slots[i]);
+    states[i] = SLOT_UNMAPPED;
+}
+
+static void op_destroy(int i) {
+    XDestroyWindow(dpy, slots[i]);
+    states[i] = SLOT_EMPTY;
+}
+
+/* a click as seen by the wm's ButtonPress selection on the client */
+static void op_focus(int i) {
+    XEvent ev = {.xbutton = {.type = ButtonPress,
+                             .window = slots[i],
+                             .root = root,
+                             .button = Button1,
+                             .same_screen = True}};
+    XSendEvent(dpy, slots[i], False, ButtonPressMask, &ev);
+}
+
+static void op_switch(int ws) {
+    XEvent ev = {.xclient = {.type = ClientMessage,
+                             .window = root,
+                             .message_type = net_current_desktop,
+                             .format = 32}};
+    ev.xclient.data.l[0] = ws;
+    XSendEvent(dpy, root, False,
+               SubstructureRedirectMask | SubstructureNotifyMask, &ev);
+}
+
+static void churn(unsigned long op) {
+    int i = next_rand() % SOAK_SLOTS;
+
+    switch (next_rand() % 8) {
+    case 0:
+    case 1:
+        if (states[i] != SLOT_MAPPED)
+            op_map(i);
+        else
+            op_unmap(i);
+        break;
+    case 2:
+        if (states[i] == SLOT_MAPPED)
+            op_unmap(i);
+        else
+            op_map(i);
+        break;
+    case 3:
+    case 4:
+        if (states[i] == SLOT_MAPPED)
+            op_focus(i);
+        else
+            op_map(i);
+        break;
+    case 5:
+        op_switch((op / 8) % 2);
+        break;
+    default:
+        if (states[i] != SLOT_EMPTY)
+            op_destroy(i);
+        else
+            op_map(i);
+        break;
+    }
+}
+
+int main(int ac, char **av) {
+    const char *wm = "./tilite";
+    unsigned long ops = 1000000;
+    long rss_bound_kb = 2048;
+    long heap_bound = 256 * 1024;
+
+    for (int i = 1; i < ac; i++) {
+        if (strcmp(av[i], "-w") == 0 && i + 1 < ac) {
+            wm = av[++i];
+        } else if (strcmp(av[i], "-n") == 0 && i + 1 < ac &&
+                   atol(av[i + 1]) > 0) {
+            ops = strtoul(av[++i], NULL, 10);
+        } else if (strcmp(av[i], "-r") == 0 && i + 1 < ac) {
+            rss_bound_kb = atol(av[++i]);
+        } else if (strcmp(av[i], "-h") == 0 && i + 1 < ac) {
+            heap_bound = atol(av[++i]);
+        } else {
+            fprintf(stderr, "usage: tilite-soak [-w wm] [-n ops] "
+                            "[-r rss_kb] [-h heap_bytes]\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    char sock[64];
+    snprintf(sock, sizeof(sock), "/tmp/tilite-soak-%ld.sock", (long)getpid());
+    setenv("TILITE_SOCKET", sock, 1);
+
+    dpy = harness_start(wm);
+    XSetErrorHandler(ignore_xerror);
+    root = DefaultRootWindow(dpy);
+    net_current_desktop = XInternAtom(dpy, "_NET_CURRENT_DESKTOP", False);
+    ipc_connect(sock);
+
+    soak_sample_t start = sample();
+    soak_sample_t base = start, peak = start, cur = start;
+    unsigned long warmup = ops / 10;
+    unsigned long every = ops / 100 ? ops / 100 : 1;
+
+    printf("%12s %10s %12s %8s %10s\n", "ops", "rss_kb", "heap", "clients",
+           "bsp_nodes");
+    for (unsigned long op = 1; op <= ops; op++) {
+        churn(op);
+        if (op % SOAK_SYNC_EVERY == 0)
+            XSync(dpy, False);
+        if (op % every)
+            continue;
+
+        XSync(dpy, False);
+        cur = sample();
+        if (op <= warmup)
+            base = cur;
+        peak.rss_kb = cur.rss_kb > peak.rss_kb ? cur.rss_kb : peak.rss_kb;
+        peak.heap = cur.heap > peak.heap ? cur.heap : peak.heap;
+        printf("%12lu %10ld %12ld %8ld %10ld\n", op, cur.rss_kb, cur.heap,
+               cur.clients, cur.nodes);
+        fflush(stdout);
+    }
+
+    /* tear everything down and give the wm time to catch up */
+    op_switch(0);
+    for (int i = 0; i < SOAK_SLOTS; i++)
+        if (states[i] != SLOT_EMPTY)
+            op_destroy(i);
+    XSync(dpy, False);
+    for (int i = 0; i < 200; i++) {
+        cur = sample();
+        if (cur.clients == start.clients && cur.nodes == start.nodes)
+            break;
+        usleep(10000);
+    }
+
+    int fail = 0;
+    if (peak.rss_kb - base.rss_kb > rss_bound_kb) {
+        printf("FAIL rss grew %ld kB after warmup (bound %ld)\n",
+               peak.rss_kb - base.rss_kb, rss_bound_kb);
+        fail = 1;
+    }
+    if (base.heap >= 0 && peak.heap - base.heap > heap_bound) {
+        printf("FAIL heap grew %ld bytes after warmup (bound %ld)\n",
+               peak.heap - base.heap, heap_bound);
+        fail = 1;
+    }
+    if (cur.clients != start.clients || cur.nodes != start.nodes) {
+        printf("FAIL %ld clients and %ld bsp nodes left, expected %ld and "
+               "%ld\n",
+               cur.clients, cur.nodes, start.clients, start.nodes);
+        fail = 1;
+    }
+    if (!fail)
+        printf("PASS %lu ops, rss %+ld kB, heap %+ld bytes after warmup\n",
+               ops, peak.rss_kb - base.rss_kb, peak.heap - base.heap);
+
+    close(ipc_fd);
+    harness_stop(dpy);
+    return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
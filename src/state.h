@@ -0,0 +1,73 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+/* layout of the read-only state region tilite publishes with shm_open. the
+ * name is exported to spawned processes as $TILITE_STATE. readers map it
+ * PROT_READ and copy it out with shm_state_read(), which needs no syscalls.
+ *
+ * seq is a seqlock: odd while tilite is writing, bumped by two on every
+ * published change, so it doubles as a cheap "did anything change" check. */
+
+#define SHM_STATE_MAGIC 0x544c5354u /* "TLST" */
+#define SHM_STATE_VERSION 2
+#define SHM_MAX_WORKSPACES 16
+#define SHM_MAX_MONITORS 8
+#define SHM_MAX_CLIENTS 128
+#define SHM_WS_NAME_LEN 16
+
+#define SHM_CLIENT_MAPPED (1u << 0)
+#define SHM_CLIENT_FLOATING (1u << 1)
+#define SHM_CLIENT_FULLSCREEN (1u << 2)
+#define SHM_CLIENT_FIXED (1u << 3)
+#define SHM_CLIENT_STICKY (1u << 4)
+#define SHM_CLIENT_HIDDEN (1u << 5) /* covered by monocle or a fullscreen */
+
+#define SHM_LAYOUT_BSP 0
+#define SHM_LAYOUT_MONOCLE 1
+
+typedef struct {
+    uint64_t win;
+    int32_t x, y, w, h;
+    uint32_t ws;
+    uint32_t flags;
+} shm_client_t;
+
+typedef struct {
+    int32_t x, y, w, h;
+    uint32_t ws; /* workspace on screen */
+} shm_monitor_t;
+
+typedef struct {
+    uint32_t current_ws;
+    uint32_t layout;
+    uint32_t global_floating;
+    uint32_t n_workspaces;
+    uint32_t n_clients;
+    uint32_t n_monitors;
+    uint64_t focused;
+    uint32_t ws_clients[SHM_MAX_WORKSPACES];
+    uint32_t ws_monitor[SHM_MAX_WORKSPACES]; /* where it shows, or would */
+    char ws_names[SHM_MAX_WORKSPACES][SHM_WS_NAME_LEN];
+    shm_monitor_t monitors[SHM_MAX_MONITORS];
+    shm_client_t clients[SHM_MAX_CLIENTS];
+} shm_snapshot_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t seq;
+    uint32_t size;
+    shm_snapshot_t snap;
+} shm_state_t;
+
+static inline void shm_state_read(const shm_state_t *st, shm_snapshot_t *out) {
+    uint32_t before, after;
+
+    do {
+        before = __atomic_load_n(&st->seq, __ATOMIC_ACQUIRE);
+        memcpy(out, &st->snap, sizeof(*out));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&st->seq, __ATOMIC_RELAXED);
+    } while ((before & 1) || before != after);
+}
@@ -0,0 +1,101 @@
+#ifdef TILITE_STATS
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <X11/Xlib.h>
+
+#include "defs.h"
+#include "stats.h"
+
+/* bucket 0 is < 1us, bucket i is [2^(i-1), 2^i) us, the last one is open */
+#define STATS_BUCKETS 24
+
+typedef struct {
+    unsigned long count;
+    unsigned long requests;
+    unsigned long roundtrips;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    unsigned long hist[STATS_BUCKETS];
+} stats_slot_t;
+
+unsigned long stats_roundtrips = 0;
+
+static stats_slot_t slots[LASTEvent];
+static struct timespec start_ts;
+static unsigned long start_req;
+static unsigned long start_rtt;
+static volatile sig_atomic_t dump_requested = 0;
+
+static void stats_sig(int sig) {
+    (void)sig;
+    dump_requested = 1;
+}
+
+void stats_begin(void) {
+    start_req = NextRequest(dpy);
+    start_rtt = stats_roundtrips;
+    clock_gettime(CLOCK_MONOTONIC, &start_ts);
+}
+
+void stats_dump(FILE *f) {
+    fprintf(f, "%-18s %8s %10s %10s %8s %8s\n", "event", "count", "avg_us",
+            "max_us", "req/ev", "rtt/ev");
+
+    for (int i = 0; i < LASTEvent; i++) {
+        stats_slot_t *s = &slots[i];
+        if (!s->count)
+            continue;
+
+        fprintf(f, "%-18s %8lu %10.1f %10.1f %8.1f %8.1f\n",
+                event_names[i] ? event_names[i] : "?", s->count,
+                s->total_ns / 1e3 / s->count, s->max_ns / 1e3,
+                (double)s->requests / s->count,
+                (double)s->roundtrips / s->count);
+
+        fprintf(f, "  hist_us");
+        for (int b = 0; b < STATS_BUCKETS; b++)
+            if (s->hist[b])
+                fprintf(f, " <%lu:%lu", 1ul << b, s->hist[b]);
+        fprintf(f, "\n");
+    }
+}
+
+void stats_end(int type) {
+    struct timespec end_ts;
+    clock_gettime(CLOCK_MONOTONIC, &end_ts);
+
+    stats_slot_t *s = &slots[type];
+    uint64_t ns = (uint64_t)(end_ts.tv_sec - start_ts.tv_sec) * 1000000000u +
+                  end_ts.tv_nsec - start_ts.tv_nsec;
+
+    int bucket = 0;
+    for (uint64_t us = ns / 1000; us && bucket < STATS_BUCKETS - 1; us >>= 1)
+        bucket++;
+
+    s->count++;
+    s->total_ns += ns;
+    s->max_ns = MAX(s->max_ns, ns);
+    s->hist[bucket]++;
+    s->roundtrips += stats_roundtrips - start_rtt;
+
+    /* the handler may have closed the display on quit */
+    if (running)
+        s->requests += NextRequest(dpy) - start_req;
+}
+
+void stats_init(void) { signal(SIGUSR1, stats_sig); }
+
+void stats_poll(void) {
+    if (!dump_requested)
+        return;
+
+    dump_requested = 0;
+    stats_dump(stderr);
+    fflush(stderr);
+}
+#else
+typedef int stats_disabled_t;
+#endif
@@ -0,0 +1,30 @@
+#pragma once
+
+/* per event type handler timing, built with -DTILITE_STATS (see Makefile).
+ * without it every hook below expands to nothing. */
+
+#ifdef TILITE_STATS
+#include <stdio.h>
+
+#include <X11/Xlib.h>
+
+extern unsigned long stats_roundtrips;
+
+void stats_begin(void);
+void stats_dump(FILE *f);
+void stats_end(int type);
+void stats_init(void);
+void stats_poll(void);
+
+#define STATS_BEGIN() stats_begin()
+#define STATS_END(type) stats_end(type)
+#define STATS_INIT() stats_init()
+#define STATS_POLL() stats_poll()
+#define STATS_ROUNDTRIP() stats_roundtrips++
+#else
+#define STATS_BEGIN()
+#define STATS_END(type)
+#define STATS_INIT()
+#define STATS_POLL()
+#define STATS_ROUNDTRIP()
+#endif
@@ -1,6 +1,10 @@
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <limits.h>
+#include <poll.h>
 #include <signal.h>
+#include <spawn.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -20,8 +24,11 @@
 
 #include "config.h"
 #include "defs.h"
+#include "layout.h"
+#include "query.h"
+#include "xcall.h"
 
-static Atom atoms[ATOM_COUNT];
+Atom atoms[ATOM_COUNT];
 static const char *atom_names[ATOM_COUNT] = {
     [ATOM_NET_ACTIVE_WINDOW] = "_NET_ACTIVE_WINDOW",
     [ATOM_NET_CURRENT_DESKTOP] = "_NET_CURRENT_DESKTOP",
@@ -56,6 +63,46 @@ static const char *atom_names[ATOM_COUNT] = {
     [ATOM_NET_WM_WINDOW_TYPE_NOTIFICATION] = "_NET_WM_WINDOW_TYPE_NOTIFICATION",
     [ATOM_NET_WM_STATE_MODAL] = "_NET_WM_STATE_MODAL",
     [ATOM_WM_PROTOCOLS] = "WM_PROTOCOLS",
+    [ATOM_NET_STARTUP_ID] = "_NET_STARTUP_ID",
+    [ATOM_NET_WM_STATE_HIDDEN] = "_NET_WM_STATE_HIDDEN",
+    [ATOM_NET_WM_BYPASS_COMPOSITOR] = "_NET_WM_BYPASS_COMPOSITOR",
+};
+
+const char *event_names[LASTEvent] = {
+    [KeyPress] = "KeyPress",
+    [KeyRelease] = "KeyRelease",
+    [ButtonPress] = "ButtonPress",
+    [ButtonRelease] = "ButtonRelease",
+    [MotionNotify] = "MotionNotify",
+    [EnterNotify] = "EnterNotify",
+    [LeaveNotify] = "LeaveNotify",
+    [FocusIn] = "FocusIn",
+    [FocusOut] = "FocusOut",
+    [KeymapNotify] = "KeymapNotify",
+    [Expose] = "Expose",
+    [GraphicsExpose] = "GraphicsExpose",
+    [NoExpose] = "NoExpose",
+    [VisibilityNotify] = "VisibilityNotify",
+    [CreateNotify] = "CreateNotify",
+    [DestroyNotify] = "DestroyNotify",
+    [UnmapNotify] = "UnmapNotify",
+    [MapNotify] = "MapNotify",
+    [MapRequest] = "MapRequest",
+    [ReparentNotify] = "ReparentNotify",
+    [ConfigureNotify] = "ConfigureNotify",
+    [ConfigureRequest] = "ConfigureRequest",
+    [GravityNotify] = "GravityNotify",
+    [ResizeRequest] = "ResizeRequest",
+    [CirculateNotify] = "CirculateNotify",
+    [CirculateRequest] = "CirculateRequest",
+    [PropertyNotify] = "PropertyNotify",
+    [SelectionClear] = "SelectionClear",
+    [SelectionRequest] = "SelectionRequest",
+    [SelectionNotify] = "SelectionNotify",
+    [ColormapNotify] = "ColormapNotify",
+    [ClientMessage] = "ClientMessage",
+    [MappingNotify] = "MappingNotify",
+    [GenericEvent] = "GenericEvent",
 };
 
 Cursor cursor_normal;
@@ -78,22 +125,33 @@ int current_ws = 0;
 long last_motion_time = 0;
 Bool global_floating = False;
 Bool in_ws_switch = False;
+/* workspaces whose monitor changed while they were hidden, one bit each.
+ * their fullscreen and floating windows are refitted when next shown */
+int stale_ws = 0;
+/* the window monocle shows on each workspace, None outside monocle */
+static Window monocle_top[NUM_WORKSPACES];
+/* first windows of the autostart batch, held back until it settles */
+Window deferred[MAX_CLIENTS];
+int n_deferred = 0;
 Bool running = False;
 Bool monocle = False;
+Bool adopting = False;
 
 Mask numlock_mask = 0;
 Mask mode_switch_mask = 0;
 
+key_table_t root_keys;
+key_table_t *active_keys = &root_keys;
+
 int scr_width;
 int scr_height;
 int open_windows = 0;
 int drag_start_x, drag_start_y;
 int drag_orig_x, drag_orig_y, drag_orig_w, drag_orig_h;
 
-int reserve_left = 0;
-int reserve_right = 0;
-int reserve_top = 0;
-int reserve_bottom = 0;
+static char *self_path = "tilite";
+static posix_spawnattr_t spawn_attr;
+static int restore_fd = -1;
 
 static char **split_cmd(const char *cmd, int *out_argc) {
     enum { NORMAL, IN_QUOTE } state = NORMAL;
@@ -129,6 +187,13 @@ static char **split_cmd(const char *cmd, int *out_argc) {
 
     if (toklen) {
         token[toklen] = '\0';
+        if (argc + 1 >= cap) {
+            char **tmp = realloc(argv, (cap + 1) * sizeof *argv);
+            if (!tmp)
+                goto err;
+
+            argv = tmp;
+        }
         argv[argc++] = strdup(token);
     }
     argv[argc] = NULL;
@@ -146,38 +211,137 @@ err:
     return NULL;
 }
 
-const char **build_argv(const char *cmd) {
+void free_pipeline(pipeline_t *p) {
+    if (!p)
+        return;
+    for (int i = 0; i < p->n_tokens; i++)
+        free(p->tokens[i]);
+    free(p->tokens);
+    free(p);
+}
+
+/* NULL if cmd has no command in it or more than MAX_STAGES stages */
+pipeline_t *build_pipeline(const char *cmd) {
     int argc = 0;
-    char **tmp = split_cmd(cmd, &argc);
-    if (!tmp)
+    char **tokens = split_cmd(cmd, &argc);
+    pipeline_t *p = tokens ? calloc(1, sizeof(*p)) : NULL;
+    if (!p) {
+        for (int i = 0; tokens && i < argc; i++)
+            free(tokens[i]);
+        free(tokens);
         return NULL;
+    }
+    p->tokens = tokens;
+    p->n_tokens = argc;
+    for (int i = 0, len = 0; i < argc && len < PIPELINE_NAME_SIZE; i++)
+        len += snprintf(p->name + len, PIPELINE_NAME_SIZE - len, "%s%s",
+                        i ? " " : "", tokens[i]);
 
-    return (const char **)tmp;
+    for (int i = 0, start = 0; i <= argc; i++) {
+        if (tokens[i] && strcmp(tokens[i], "|") != 0)
+            continue;
+        if (i > start) {
+            if (p->n_stages == MAX_STAGES) {
+                free_pipeline(p);
+                return NULL;
+            }
+            p->stage[p->n_stages++] = &tokens[start];
+        }
+        if (tokens[i]) {
+            free(tokens[i]);
+            tokens[i] = NULL;
+        }
+        start = i + 1;
+    }
+
+    if (!p->n_stages) {
+        free_pipeline(p);
+        return NULL;
+    }
+    return p;
 }
 
-static void load_config(void) {
-    user_config.modkey = MODKEY;
-    user_config.gaps = CFG_GAPS;
-    user_config.border_width = CFG_BORDER_WIDTH;
-    user_config.move_window_amt = CFG_MOVE_WINDOW_AMT;
-    user_config.resize_window_amt = CFG_RESIZE_WINDOW_AMT;
-    user_config.snap_distance = CFG_SNAP_DISTANCE;
-    user_config.motion_throttle = CFG_MOTION_THROTTLE;
-    user_config.new_win_focus = CFG_NEW_WIN_FOCUS;
-    user_config.warp_cursor = CFG_WARP_CURSOR;
-    user_config.floating_on_top = CFG_FLOATING_ON_TOP;
+/* the compiled in defaults from config.h */
+void load_config(config_t *cfg) {
+    cfg->modkey = MODKEY;
+    cfg->gaps = CFG_GAPS;
+    cfg->border_width = CFG_BORDER_WIDTH;
+    cfg->move_window_amt = CFG_MOVE_WINDOW_AMT;
+    cfg->resize_window_amt = CFG_RESIZE_WINDOW_AMT;
+    cfg->snap_distance = CFG_SNAP_DISTANCE;
+    cfg->motion_throttle = CFG_MOTION_THROTTLE;
+    cfg->new_win_focus = CFG_NEW_WIN_FOCUS;
+    cfg->warp_cursor = CFG_WARP_CURSOR;
+    cfg->floating_on_top = CFG_FLOATING_ON_TOP;
+    cfg->monocle_hide = CFG_MONOCLE_HIDE;
+    cfg->fullscreen_hide = CFG_FULLSCREEN_HIDE;
 
-    user_config.border_foc_col = parse_col(CFG_FOCUSED_BORDER_COL);
-    user_config.border_ufoc_col = parse_col(CFG_UNFOCUSED_BORDER_COL);
-    user_config.border_swap_col = parse_col(CFG_SWAP_BORDER_COL);
+    cfg->border_foc_col = parse_col(CFG_FOCUSED_BORDER_COL);
+    cfg->border_ufoc_col = parse_col(CFG_UNFOCUSED_BORDER_COL);
+    cfg->border_swap_col = parse_col(CFG_SWAP_BORDER_COL);
 
     binding_t binds[] = {CFG_BINDS};
-    user_config.n_binds = (int)(sizeof(binds) / sizeof(binds[0]));
-    for (int i = 0; i < user_config.n_binds; i++)
-        user_config.binds[i] = binds[i];
-}
+    cfg->n_binds = (int)(sizeof(binds) / sizeof(binds[0]));
+    for (int i = 0; i < cfg->n_binds; i++)
+        cfg->binds[i] = binds[i];
 
-client_t *add_client(Window w, int ws) {
+    const struct {
+        const char *cmd;
+        int ws;
+    } to_run[] = {CFG_AUTOSTART{NULL, 0}};
+    cfg->n_to_run = 0;
+    for (int i = 0; to_run[i].cmd && cfg->n_to_run < MAX_ITEMS; i++) {
+        pipeline_t *p = build_pipeline(to_run[i].cmd);
+        if (p)
+            cfg->to_run[cfg->n_to_run++] = (autostart_t){p, to_run[i].ws - 1};
+    }
+
+    const rule_t rules[] = {CFG_RULES{.class = ""}};
+    cfg->n_rules = 0;
+    for (size_t i = 0; i + 1 < sizeof(rules) / sizeof(rules[0]) &&
+                       cfg->n_rules < MAX_ITEMS;
+         i++) {
+        cfg->rules[cfg->n_rules] = rules[i];
+        cfg->rules[cfg->n_rules++].action.ws--;
+    }
+}
+
+/* keeps what tiling needs from q's WM_NORMAL_HINTS, with ICCCM's
+ * fallbacks between the base and the minimum size */
+static void cache_hints(client_t *c, const win_query_t *q) {
+    size_hints_t *sh = &c->hints;
+    long f = q->hint_flags;
+
+    memset(sh, 0, sizeof(*sh));
+    if (f & PBaseSize) {
+        sh->base_w = q->base_w;
+        sh->base_h = q->base_h;
+    } else if (f & PMinSize) {
+        sh->base_w = q->min_w;
+        sh->base_h = q->min_h;
+    }
+    if (f & PMinSize) {
+        sh->min_w = q->min_w;
+        sh->min_h = q->min_h;
+    } else if (f & PBaseSize) {
+        sh->min_w = q->base_w;
+        sh->min_h = q->base_h;
+    }
+    if (f & PMaxSize) {
+        sh->max_w = q->max_w;
+        sh->max_h = q->max_h;
+    }
+    if (f & PResizeInc) {
+        sh->inc_w = q->inc_w;
+        sh->inc_h = q->inc_h;
+    }
+    if ((f & PAspect) && q->min_aspect_y > 0 && q->max_aspect_y > 0) {
+        sh->min_aspect = (float)q->min_aspect_x / q->min_aspect_y;
+        sh->max_aspect = (float)q->max_aspect_x / q->max_aspect_y;
+    }
+}
+
+client_t *add_client(Window w, int ws, const win_query_t *q) {
     client_t *c = malloc(sizeof(client_t));
     if (!c) {
         fprintf(stderr, "tilite: could not alloc memory for client\n");
@@ -201,30 +365,25 @@ client_t *add_client(Window w, int ws) {
     }
     open_windows++;
 
-    Mask window_masks = EnterWindowMask | LeaveWindowMask | FocusChangeMask |
-                        PropertyChangeMask | StructureNotifyMask |
-                        ButtonPressMask | ButtonReleaseMask | PointerMotionMask;
-    select_input(w, window_masks);
-    grab_button(Button1, None, w, False, ButtonPressMask);
-    grab_button(Button1, user_config.modkey, w, False, ButtonPressMask);
-    grab_button(Button1, user_config.modkey | ShiftMask, w, False,
-                ButtonPressMask);
-    grab_button(Button3, user_config.modkey, w, False, ButtonPressMask);
+    select_input(w, CLIENT_EVENT_MASK);
+    grab_client_buttons(w);
 
     Atom protos[] = {atoms[ATOM_WM_DELETE_WINDOW]};
     XSetWMProtocols(dpy, w, protos, 1);
 
-    XWindowAttributes wa;
-    XGetWindowAttributes(dpy, w, &wa);
-    c->x = wa.x;
-    c->y = wa.y;
-    c->w = wa.width;
-    c->h = wa.height;
+    c->x = q->x;
+    c->y = q->y;
+    c->w = q->w;
+    c->h = q->h;
 
     c->fixed = False;
     c->floating = False;
     c->fullscreen = False;
+    c->sticky = False;
     c->mapped = True;
+    c->hidden = COVER_SHOW;
+    c->bypass = -1;
+    cache_hints(c, q);
 
     if (global_floating)
         c->floating = True;
@@ -245,10 +404,173 @@ client_t *add_client(Window w, int ws) {
     long desktop = ws;
     XChangeProperty(dpy, w, atoms[ATOM_NET_WM_DESKTOP], XA_CARDINAL, 32,
                     PropModeReplace, (unsigned char *)&desktop, 1);
-    XRaiseWindow(dpy, w);
+    /* adopted windows keep their stacking order */
+    if (!adopting)
+        XRaiseWindow(dpy, w);
+    ipc_notify(IPC_EV_ADD, w, ws);
     return c;
 }
 
+/* moves c onto ws's list and tree, its window is left where it is */
+static void relocate_client(client_t *c, int ws, client_t *split_target) {
+    int from_ws = c->ws;
+
+    /* remove from current list */
+    client_t **pp = &workspaces[from_ws];
+    while (*pp && *pp != c)
+        pp = &(*pp)->next;
+
+    if (*pp)
+        *pp = c->next;
+    if (ws_focused[from_ws] == c)
+        ws_focused[from_ws] = NULL;
+
+    /* update BSP trees */
+    bsp_remove(&bsp_roots[from_ws], c);
+    if (!c->floating && !c->fullscreen)
+        bsp_insert(&bsp_roots[ws], split_target, c);
+
+    /* push to target list */
+    c->next = workspaces[ws];
+    workspaces[ws] = c;
+    c->ws = ws;
+    long desktop = ws;
+    XChangeProperty(dpy, c->win, atoms[ATOM_NET_WM_DESKTOP], XA_CARDINAL, 32,
+                    PropModeReplace, (unsigned char *)&desktop, 1);
+    ipc_notify(IPC_EV_MOVE, c->win, ws);
+
+    /* remember it as last-focused for the target workspace */
+    ws_focused[ws] = c;
+}
+
+static binding_t *find_bind(config_t *cfg, int mods, KeySym keysym) {
+    for (int i = 0; i < cfg->n_binds; i++)
+        if (cfg->binds[i].mods == mods && cfg->binds[i].keysym == keysym)
+            return &cfg->binds[i];
+    return NULL;
+}
+
+/* switches to next, touching only what differs from the running config */
+void apply_config(const config_t *next) {
+    static config_t prev;
+    prev = user_config;
+    user_config = *next;
+    rules_build(&user_config);
+
+    if (prev.modkey != user_config.modkey) {
+        /* every mouse grab and workspace binding hangs off the mod key */
+        XUngrabButton(dpy, AnyButton, AnyModifier, root);
+        grab_root_buttons();
+        for (int ws = 0; ws < NUM_WORKSPACES; ws++) {
+            for (client_t *c = workspaces[ws]; c; c = c->next) {
+                XUngrabButton(dpy, AnyButton, AnyModifier, c->win);
+                grab_client_buttons(c->win);
+            }
+        }
+        grab_keys();
+    } else {
+        /* only keys that appeared or went away are (un)grabbed */
+        for (int i = 0; i < prev.n_binds; i++) {
+            binding_t *b = &prev.binds[i];
+            binding_t *now = find_bind(&user_config, b->mods, b->keysym);
+            if (bind_grabbable(b) && (!now || !bind_grabbable(now)))
+                grab_bind(b, False);
+        }
+        for (int i = 0; i < user_config.n_binds; i++) {
+            binding_t *b = &user_config.binds[i];
+            binding_t *old = find_bind(&prev, b->mods, b->keysym);
+            if (old && bind_grabbable(old) == bind_grabbable(b))
+                b->keycode = old->keycode;
+            else
+                grab_bind(b, True);
+        }
+        key_table_build(&root_keys, user_config.binds, user_config.n_binds);
+    }
+
+    for (int i = 0; i < prev.n_binds; i++)
+        if (prev.binds[i].type == TYPE_CMD)
+            free_pipeline(prev.binds[i].action.cmd);
+    for (int i = 0; i < prev.n_to_run; i++)
+        free_pipeline(prev.to_run[i].cmd);
+
+    if (prev.border_width != user_config.border_width) {
+        for (int ws = 0; ws < NUM_WORKSPACES; ws++)
+            for (client_t *c = workspaces[ws]; c; c = c->next)
+                if (!c->fullscreen)
+                    XSetWindowBorderWidth(dpy, c->win,
+                                          user_config.border_width);
+    }
+    if (prev.border_width != user_config.border_width ||
+        prev.gaps != user_config.gaps ||
+        prev.monocle_hide != user_config.monocle_hide ||
+        prev.fullscreen_hide != user_config.fullscreen_hide)
+        tile();
+    else if (prev.border_foc_col != user_config.border_foc_col ||
+             prev.border_ufoc_col != user_config.border_ufoc_col)
+        update_borders();
+}
+
+/* asks the compositor to leave c's window alone while it is fullscreen,
+ * and hands back whatever the client had set itself afterwards. a client
+ * that set 2 wants to stay composited and is not overruled */
+static void set_bypass(client_t *c, Bool on) {
+    Atom prop = atoms[ATOM_NET_WM_BYPASS_COMPOSITOR];
+    if (on) {
+        Atom type;
+        int format;
+        unsigned long n = 0, after;
+        long *val = NULL;
+        c->bypass = -1;
+        if (XGetWindowProperty(dpy, c->win, prop, 0, 1, False, XA_CARDINAL,
+                               &type, &format, &n, &after,
+                               (unsigned char **)&val) == Success &&
+            val) {
+            if (n)
+                c->bypass = val[0];
+            XFree(val);
+        }
+        if (c->bypass == 1 || c->bypass == 2)
+            return;
+        long one = 1;
+        XChangeProperty(dpy, c->win, prop, XA_CARDINAL, 32, PropModeReplace,
+                        (unsigned char *)&one, 1);
+    } else if (c->bypass < 0) {
+        XDeleteProperty(dpy, c->win, prop);
+    } else if (c->bypass != 1 && c->bypass != 2) {
+        XChangeProperty(dpy, c->win, prop, XA_CARDINAL, 32, PropModeReplace,
+                        (unsigned char *)&c->bypass, 1);
+    }
+}
+
+/* covers c's monitor with it, borderless and unredirected. orig_* must
+ * already hold the geometry to go back to */
+static void enter_fullscreen(client_t *c) {
+    monitor_t *mon = &monitors[ws_mon[c->ws]];
+
+    c->fullscreen = True;
+    c->floating = False;
+    bsp_remove(&bsp_roots[c->ws], c);
+
+    c->x = mon->x;
+    c->y = mon->y;
+    c->w = mon->w;
+    c->h = mon->h;
+    XWindowChanges wc = {.x = c->x, .y = c->y, .width = c->w, .height = c->h};
+    XConfigureWindow(dpy, c->win,
+                     CWX | CWY | CWWidth | CWHeight | CWBorderWidth, &wc);
+    XRaiseWindow(dpy, c->win);
+    window_set_ewmh_state(c->win, atoms[ATOM_NET_WM_STATE_FULLSCREEN], True);
+    set_bypass(c, True);
+}
+
+/* the fullscreen window on ws, NULL for none */
+static client_t *ws_fullscreen(int ws) {
+    for (client_t *c = workspaces[ws]; c; c = c->next)
+        if (c->fullscreen && c->mapped)
+            return c;
+    return NULL;
+}
+
 void apply_fullscreen(client_t *c, Bool on) {
     if (!c || !c->mapped || c->fullscreen == on)
         return;
@@ -263,24 +585,15 @@ void apply_fullscreen(client_t *c, Bool on) {
         c->orig_w = win_attr.width;
         c->orig_h = win_attr.height;
 
-        c->fullscreen = True;
-
-        bsp_remove(&bsp_roots[current_ws], c);
-
-        XMoveResizeWindow(dpy, c->win, 0, 0, scr_width, scr_height);
-
-        c->x = 0;
-        c->y = 0;
-        c->w = scr_width;
-        c->h = scr_height;
-
-        XRaiseWindow(dpy, c->win);
-        window_set_ewmh_state(c->win, atoms[ATOM_NET_WM_STATE_FULLSCREEN],
-                              True);
+        enter_fullscreen(c);
+        /* the windows under it stop being laid out, see tile_ws() */
+        if (ws_visible(c->ws))
+            tile_ws(c->ws);
     } else {
         c->fullscreen = False;
+        set_bypass(c, False);
 
-        bsp_insert(&bsp_roots[current_ws], NULL, c);
+        bsp_insert(&bsp_roots[c->ws], NULL, c);
 
         XMoveResizeWindow(dpy, c->win, c->orig_x, c->orig_y, c->orig_w,
                           c->orig_h);
@@ -298,8 +611,44 @@ void apply_fullscreen(client_t *c, Bool on) {
     }
 }
 
+/* starts every to_run entry at once. their windows are held back and laid
+ * out together once they stop arriving, see map_deferred() */
+void autostart(void) {
+    if (!user_config.n_to_run)
+        return;
+    launch_batch(True);
+    for (int i = 0; i < user_config.n_to_run; i++)
+        spawn(user_config.to_run[i].cmd, user_config.to_run[i].ws);
+}
+
+/* puts ws's fullscreen windows over its monitor again and brings floating
+ * ones whose centre is off it back on */
+static void refit_ws(int ws) {
+    int m = ws_mon[ws];
+    monitor_t *mon = &monitors[m];
+
+    stale_ws &= ~(1 << ws);
+    for (client_t *c = workspaces[ws]; c; c = c->next) {
+        if (c->fullscreen) {
+            c->x = mon->x;
+            c->y = mon->y;
+            c->w = mon->w;
+            c->h = mon->h;
+        } else if (c->floating &&
+                   monitor_at(c->x + c->w / 2, c->y + c->h / 2) != m) {
+            c->w = MIN(c->w, mon->w);
+            c->h = MIN(c->h, mon->h);
+            c->x = mon->x + (mon->w - c->w) / 2;
+            c->y = mon->y + (mon->h - c->h) / 2;
+        } else {
+            continue;
+        }
+        XMoveResizeWindow(dpy, c->win, c->x, c->y, c->w, c->h);
+    }
+}
+
 void change_workspace(int ws) {
-    if (ws >= NUM_WORKSPACES || ws == current_ws)
+    if (ws < 0 || ws >= NUM_WORKSPACES || ws == current_ws)
         return;
 
     ws_focused[current_ws] = focused;
@@ -307,20 +656,41 @@ void change_workspace(int ws) {
     in_ws_switch = True;
     XGrabServer(dpy);
 
-    for (client_t *c = workspaces[current_ws]; c; c = c->next) {
-        if (c->mapped) {
-            XUnmapWindow(dpy, c->win);
+    if (ws_visible(ws)) {
+        /* already on another monitor, only the focus goes over */
+        current_ws = ws;
+    } else {
+        /* the focused monitor swaps its windows, the others keep theirs */
+        int mon = ws_mon[current_ws], from = current_ws;
+        for (client_t *c = workspaces[current_ws]; c; c = c->next) {
+            if (c->mapped && !c->sticky) {
+                XUnmapWindow(dpy, c->win);
+            }
         }
-    }
 
-    current_ws = ws;
-    for (client_t *c = workspaces[current_ws]; c; c = c->next) {
-        if (c->mapped) {
-            XMapWindow(dpy, c->win);
+        monitors[mon].ws = ws;
+        ws_mon[ws] = mon;
+        current_ws = ws;
+        if (stale_ws & 1 << ws)
+            refit_ws(ws);
+        for (client_t *c = workspaces[current_ws]; c; c = c->next) {
+            if (c->mapped && c->hidden != COVER_UNMAP) {
+                XMapWindow(dpy, c->win);
+            }
         }
-    }
 
-    tile();
+        /* sticky windows stay up and come along to ws */
+        client_t *last = ws_focused[ws];
+        for (client_t *c = workspaces[from], *next; c; c = next) {
+            next = c->next;
+            if (c->sticky)
+                relocate_client(c, ws, NULL);
+        }
+        if (last)
+            ws_focused[ws] = last;
+
+        tile();
+    }
 
     focused = ws_focused[current_ws];
 
@@ -355,6 +725,7 @@ void change_workspace(int ws) {
     XUngrabServer(dpy);
     XSync(dpy, False);
     in_ws_switch = False;
+    ipc_notify(IPC_EV_WORKSPACE, None, current_ws);
 }
 
 int clean_mask(int mask) {
@@ -425,89 +796,31 @@ Window find_toplevel(Window w) {
     return w;
 }
 
-/* Find the best tiled neighbor of 'src' in a given direction.
- * dir: 0=left, 1=right, 2=up, 3=down */
-static client_t *bsp_find_neighbor(client_t *src, int dir) {
-    if (!src || src->floating || !src->mapped)
-        return NULL;
-
-    int src_cx = src->x + src->w / 2;
-    int src_cy = src->y + src->h / 2;
-
-    client_t *best = NULL;
-    int best_dist = INT_MAX;
-
-    for (client_t *c = workspaces[current_ws]; c; c = c->next) {
-        if (c == src || c->floating || !c->mapped || c->fullscreen)
-            continue;
-
-        int c_cx = c->x + c->w / 2;
-        int c_cy = c->y + c->h / 2;
-
-        switch (dir) {
-        case 0: /* left */
-            if (c->x + c->w >= src->x)
-                continue;
-            if (c->y + c->h <= src->y || c->y >= src->y + src->h)
-                continue;
-            {
-                int dist = src_cx - c_cx;
-                if (dist < best_dist) {
-                    best_dist = dist;
-                    best = c;
-                }
-            }
-            break;
-        case 1: /* right */
-            if (c->x <= src->x + src->w)
-                continue;
-            if (c->y + c->h <= src->y || c->y >= src->y + src->h)
-                continue;
-            {
-                int dist = c_cx - src_cx;
-                if (dist < best_dist) {
-                    best_dist = dist;
-                    best = c;
-                }
-            }
-            break;
-        case 2: /* up */
-            if (c->y + c->h >= src->y)
-                continue;
-            if (c->x + c->w <= src->x || c->x >= src->x + src->w)
-                continue;
-            {
-                int dist = src_cy - c_cy;
-                if (dist < best_dist) {
-                    best_dist = dist;
-                    best = c;
-                }
-            }
-            break;
-        case 3: /* down */
-            if (c->y <= src->y + src->h)
-                continue;
-            if (c->x + c->w <= src->x || c->x >= src->x + src->w)
-                continue;
-            {
-                int dist = c_cy - src_cy;
-                if (dist < best_dist) {
-                    best_dist = dist;
-                    best = c;
-                }
-            }
-            break;
+static void focus_dir(int dir) {
+    client_t *nb =
+        focused ? bsp_find_neighbor(workspaces[current_ws], focused, dir)
+                : NULL;
+    if (!nb) {
+        /* off the edge of this tree, carry on into the next monitor */
+        int mon = monitor_neighbor(ws_mon[current_ws], dir);
+        if (mon < 0)
+            return;
+        int ws = monitors[mon].ws;
+        if (focused)
+            nb = bsp_find_neighbor(workspaces[ws], focused, dir);
+        if (!nb && ws_focused[ws] && ws_focused[ws]->mapped)
+            nb = ws_focused[ws];
+        if (!nb) {
+            ws_focused[current_ws] = focused;
+            set_current_ws(ws);
+            set_input_focus(NULL, False, False);
+            if (user_config.warp_cursor)
+                XWarpPointer(dpy, None, root, 0, 0, 0, 0,
+                             monitors[mon].x + monitors[mon].w / 2,
+                             monitors[mon].y + monitors[mon].h / 2);
+            return;
         }
     }
-    return best;
-}
-
-static void focus_dir(int dir) {
-    if (!focused)
-        return;
-    client_t *nb = bsp_find_neighbor(focused, dir);
-    if (!nb)
-        return;
     focused = nb;
     set_input_focus(focused, True, True);
 }
@@ -517,14 +830,10 @@ void focus_right(void) { focus_dir(1); }
 void focus_up(void) { focus_dir(2); }
 void focus_down(void) { focus_dir(3); }
 
-int get_workspace_for_window(Window w) {
-    XClassHint ch = {0};
-    if (!XGetClassHint(dpy, w, &ch))
-        return current_ws;
-
-    XFree(ch.res_class);
-    XFree(ch.res_name);
-
+int get_workspace_for_window(const win_query_t *q) {
+    /* left by a previous wm, or asked for by the client before mapping */
+    if (q->desktop >= 0 && q->desktop < NUM_WORKSPACES)
+        return (int)q->desktop;
     return current_ws;
 }
 
@@ -538,7 +847,33 @@ void grab_button(Mask button, Mask mod, Window w, Bool owner_events,
                     GrabModeAsync, None, None);
 }
 
-void grab_keys(void) {
+/* workspace bindings only count with the configured mod key */
+Bool bind_grabbable(const binding_t *bind) {
+    return !((bind->type == TYPE_WS_CHANGE &&
+              bind->mods != user_config.modkey) ||
+             (bind->type == TYPE_WS_MOVE &&
+              bind->mods != (user_config.modkey | ShiftMask)));
+}
+
+/* grabs or releases one binding under every lock modifier combination */
+void grab_bind(binding_t *bind, Bool grab) {
+    if (!bind_grabbable(bind))
+        return;
+
+    bind->keycode = XKeysymToKeycode(dpy, bind->keysym);
+    if (bind->keycode)
+        grab_keycode(bind->keycode, bind->mods, grab);
+}
+
+void grab_client_buttons(Window w) {
+    grab_button(Button1, None, w, False, ButtonPressMask);
+    grab_button(Button1, user_config.modkey, w, False, ButtonPressMask);
+    grab_button(Button1, user_config.modkey | ShiftMask, w, False,
+                ButtonPressMask);
+    grab_button(Button3, user_config.modkey, w, False, ButtonPressMask);
+}
+
+void grab_keycode(KeyCode code, int mods, Bool grab) {
     Mask guards[] = {0,
                      LockMask,
                      numlock_mask,
@@ -547,30 +882,38 @@ void grab_keys(void) {
                      LockMask | mode_switch_mask,
                      numlock_mask | mode_switch_mask,
                      LockMask | numlock_mask | mode_switch_mask};
-    XUngrabKey(dpy, AnyKey, AnyModifier, root);
-
-    for (int i = 0; i < user_config.n_binds; i++) {
-        binding_t *bind = &user_config.binds[i];
-
-        if ((bind->type == TYPE_WS_CHANGE &&
-             bind->mods != user_config.modkey) ||
-            (bind->type == TYPE_WS_MOVE &&
-             bind->mods != (user_config.modkey | ShiftMask))) {
-            continue;
-        }
 
-        bind->keycode = XKeysymToKeycode(dpy, bind->keysym);
-        if (!bind->keycode)
-            continue;
-
-        for (size_t guard = 0; guard < sizeof(guards) / sizeof(guards[0]);
-             guard++) {
-            XGrabKey(dpy, bind->keycode, bind->mods | guards[guard], root, True,
+    for (size_t guard = 0; guard < sizeof(guards) / sizeof(guards[0]);
+         guard++) {
+        if (grab)
+            XGrabKey(dpy, code, mods | guards[guard], root, True,
                      GrabModeAsync, GrabModeAsync);
-        }
+        else
+            XUngrabKey(dpy, code, mods | guards[guard], root);
     }
 }
 
+void grab_keys(void) {
+    XUngrabKey(dpy, AnyKey, AnyModifier, root);
+    for (int i = 0; i < user_config.n_binds; i++)
+        grab_bind(&user_config.binds[i], True);
+    key_table_build(&root_keys, user_config.binds, user_config.n_binds);
+}
+
+/* grab mouse button events on root window */
+void grab_root_buttons(void) {
+    Mask root_click_masks =
+        ButtonPressMask | ButtonReleaseMask | PointerMotionMask;
+    Mask root_swap_masks =
+        ButtonPressMask | ButtonReleaseMask | PointerMotionMask;
+    Mask root_resize_masks =
+        ButtonPressMask | ButtonReleaseMask | PointerMotionMask;
+    grab_button(Button1, user_config.modkey, root, True, root_click_masks);
+    grab_button(Button1, user_config.modkey | ShiftMask, root, True,
+                root_swap_masks);
+    grab_button(Button3, user_config.modkey, root, True, root_resize_masks);
+}
+
 void hdl_button(XEvent *xev) {
     XButtonEvent *xbutton = &xev->xbutton;
     Window w =
@@ -584,60 +927,14 @@ void hdl_button(XEvent *xev) {
     if (!w)
         return;
 
-    client_t *head = workspaces[current_ws];
-    for (client_t *c = head; c; c = c->next) {
-        if (c->win != w)
-            continue;
-
-        Bool is_swap_mode = (xbutton->state & user_config.modkey) &&
-                            (xbutton->state & ShiftMask) &&
-                            xbutton->button == left_click && !c->floating;
-        if (is_swap_mode) {
-            drag_client = c;
-            drag_start_x = xbutton->x_root;
-            drag_start_y = xbutton->y_root;
-            drag_orig_x = c->x;
-            drag_orig_y = c->y;
-            drag_orig_w = c->w;
-            drag_orig_h = c->h;
-            drag_mode = DRAG_SWAP;
-            XGrabPointer(dpy, root, True, ButtonReleaseMask | PointerMotionMask,
-                         GrabModeAsync, GrabModeAsync, None, cursor_move,
-                         CurrentTime);
-            focused = c;
-            set_input_focus(focused, False, False);
-            XSetWindowBorder(dpy, c->win, user_config.border_swap_col);
-            return;
-        }
-
-        Bool is_move_resize =
-            (xbutton->state & user_config.modkey) &&
-            (xbutton->button == left_click || xbutton->button == right_click) &&
-            !c->floating;
-        if (is_move_resize) {
-            focused = c;
-            toggle_floating();
-        }
-
-        Bool is_single_click = !(xbutton->state & user_config.modkey) &&
-                               xbutton->button == left_click;
-        if (is_single_click) {
-            focused = c;
-            set_input_focus(focused, True, False);
-            return;
-        }
-
-        if (!c->floating)
-            return;
-
-        if (c->fixed && xbutton->button == right_click)
-            return;
-
-        Cursor cursor =
-            (xbutton->button == left_click) ? cursor_move : cursor_resize;
-        XGrabPointer(dpy, root, True, ButtonReleaseMask | PointerMotionMask,
-                     GrabModeAsync, GrabModeAsync, None, cursor, CurrentTime);
+    client_t *c = find_client(w);
+    if (!c || !ws_visible(c->ws))
+        return;
 
+    Bool is_swap_mode = (xbutton->state & user_config.modkey) &&
+                        (xbutton->state & ShiftMask) &&
+                        xbutton->button == left_click && !c->floating;
+    if (is_swap_mode) {
         drag_client = c;
         drag_start_x = xbutton->x_root;
         drag_start_y = xbutton->y_root;
@@ -645,12 +942,55 @@ void hdl_button(XEvent *xev) {
         drag_orig_y = c->y;
         drag_orig_w = c->w;
         drag_orig_h = c->h;
-        drag_mode = (xbutton->button == left_click) ? DRAG_MOVE : DRAG_RESIZE;
+        drag_mode = DRAG_SWAP;
+        XGrabPointer(dpy, root, True, ButtonReleaseMask | PointerMotionMask,
+                     GrabModeAsync, GrabModeAsync, None, cursor_move,
+                     CurrentTime);
         focused = c;
+        set_input_focus(focused, False, False);
+        XSetWindowBorder(dpy, c->win, user_config.border_swap_col);
+        return;
+    }
 
+    Bool is_move_resize =
+        (xbutton->state & user_config.modkey) &&
+        (xbutton->button == left_click || xbutton->button == right_click) &&
+        !c->floating;
+    if (is_move_resize) {
+        focused = c;
+        toggle_floating();
+    }
+
+    Bool is_single_click = !(xbutton->state & user_config.modkey) &&
+                           xbutton->button == left_click;
+    if (is_single_click) {
+        focused = c;
         set_input_focus(focused, True, False);
         return;
     }
+
+    if (!c->floating)
+        return;
+
+    if (c->fixed && xbutton->button == right_click)
+        return;
+
+    Cursor cursor =
+        (xbutton->button == left_click) ? cursor_move : cursor_resize;
+    XGrabPointer(dpy, root, True, ButtonReleaseMask | PointerMotionMask,
+                 GrabModeAsync, GrabModeAsync, None, cursor, CurrentTime);
+
+    drag_client = c;
+    drag_start_x = xbutton->x_root;
+    drag_start_y = xbutton->y_root;
+    drag_orig_x = c->x;
+    drag_orig_y = c->y;
+    drag_orig_w = c->w;
+    drag_orig_h = c->h;
+    drag_mode = (xbutton->button == left_click) ? DRAG_MOVE : DRAG_RESIZE;
+    focused = c;
+
+    set_input_focus(focused, True, False);
 }
 
 void hdl_button_release(XEvent *xev) {
@@ -666,6 +1006,14 @@ void hdl_button_release(XEvent *xev) {
         }
         tile();
         update_borders();
+    } else if (drag_mode == DRAG_MOVE && drag_client) {
+        /* dropped onto another monitor, it joins the workspace shown there */
+        int mon = monitor_at(drag_client->x + drag_client->w / 2,
+                             drag_client->y + drag_client->h / 2);
+        if (mon >= 0 && monitors[mon].ws != drag_client->ws) {
+            relocate_client(drag_client, monitors[mon].ws, NULL);
+            set_input_focus(drag_client, False, False);
+        }
     }
 
     XUngrabPointer(dpy, CurrentTime);
@@ -720,8 +1068,9 @@ void hdl_client_msg(XEvent *xev) {
 
 void hdl_config_ntf(XEvent *xev) {
     if (xev->xconfigure.window == root) {
-        tile();
-        update_borders();
+        scr_width = xev->xconfigure.width;
+        scr_height = xev->xconfigure.height;
+        update_monitors();
     }
 }
 
@@ -734,7 +1083,7 @@ void hdl_config_req(XEvent *xev) {
             if (c->win == config_ev->window)
                 break;
 
-    if (!c || c->floating || c->fullscreen) {
+    if (!c || c->floating) {
         /* allow client to configure itself */
         XWindowChanges wc = {.x = config_ev->x,
                              .y = config_ev->y,
@@ -746,6 +1095,31 @@ void hdl_config_req(XEvent *xev) {
         XConfigureWindow(dpy, config_ev->window, config_ev->value_mask, &wc);
         return;
     }
+
+    /* a fullscreen window keeps covering its monitor without a border, it
+     * may only restack itself */
+    Mask stack = config_ev->value_mask & (CWSibling | CWStackMode);
+    if (c->fullscreen && stack) {
+        XWindowChanges wc = {.sibling = config_ev->above,
+                             .stack_mode = config_ev->detail};
+        XConfigureWindow(dpy, c->win, stack, &wc);
+    }
+
+    /* tiled and fullscreen windows keep their geometry, tell them so or some
+     * keep asking */
+    XConfigureEvent ce = {.type = ConfigureNotify,
+                          .display = dpy,
+                          .event = c->win,
+                          .window = c->win,
+                          .x = c->x,
+                          .y = c->y,
+                          .width = c->w,
+                          .height = c->h,
+                          .border_width =
+                              c->fullscreen ? 0 : user_config.border_width,
+                          .above = None,
+                          .override_redirect = False};
+    XSendEvent(dpy, c->win, False, StructureNotifyMask, (XEvent *)&ce);
 }
 
 void hdl_dummy(XEvent *xev) { (void)xev; }
@@ -778,19 +1152,20 @@ void hdl_destroy_ntf(XEvent *xev) {
         else
             prev->next = c->next;
 
-        /* remove from BSP tree — only if still mapped (unmap handler already
-         * removes it for the normal close path) */
-        if (c->mapped && !c->floating && !c->fullscreen)
-            bsp_remove(&bsp_roots[i], c);
+        /* remove from BSP tree. usually the unmap handler already did, but a
+         * leaf left behind here would point at freed memory */
+        bsp_remove(&bsp_roots[i], c);
 
+        ipc_notify(IPC_EV_REMOVE, c->win, i);
         free(c);
         update_net_client_list();
         open_windows--;
 
-        if (i == current_ws) {
+        if (ws_visible(i)) {
             tile();
             update_borders();
-
+        }
+        if (i == current_ws) {
             /* prefer previous window else next */
             client_t *foc_new = NULL;
             if (prev && prev->mapped)
@@ -815,110 +1190,126 @@ void hdl_destroy_ntf(XEvent *xev) {
 }
 
 void hdl_keypress(XEvent *xev) {
-    KeyCode code = xev->xkey.keycode;
-    int mods = clean_mask(xev->xkey.state);
+    binding_t *bind = key_table_find(active_keys, xev->xkey.keycode,
+                                     clean_mask(xev->xkey.state));
+    if (!bind)
+        return;
 
-    for (int i = 0; i < user_config.n_binds; i++) {
-        binding_t *bind = &user_config.binds[i];
-        if (bind->keycode == code && clean_mask(bind->mods) == mods) {
-            switch (bind->type) {
-            case TYPE_CMD:
-                spawn(bind->action.cmd);
-                break;
-            case TYPE_FUNC:
-                if (bind->action.fn)
-                    bind->action.fn();
-                break;
-            case TYPE_WS_CHANGE:
-                change_workspace(bind->action.ws);
-                update_net_client_list();
-                break;
-            case TYPE_WS_MOVE:
-                move_to_workspace(bind->action.ws);
-                update_net_client_list();
-                break;
-            }
-            return;
-        }
+    switch (bind->type) {
+    case TYPE_CMD:
+        spawn(bind->action.cmd, -1);
+        break;
+    case TYPE_FUNC:
+        if (bind->action.fn)
+            bind->action.fn();
+        break;
+    case TYPE_WS_CHANGE:
+        change_workspace(bind->action.ws);
+        update_net_client_list();
+        break;
+    case TYPE_WS_MOVE:
+        move_to_workspace(bind->action.ws);
+        update_net_client_list();
+        break;
     }
 }
 
+/* layout switchers can send these in bursts, so only the bindings whose
+ * keycode moved are regrabbed. everything is regrabbed only when a lock
+ * modifier changed bits, since that changes every guard combination */
 void hdl_mapping_ntf(XEvent *xev) {
-    XRefreshKeyboardMapping(&xev->xmapping);
-    update_modifier_masks();
-    grab_keys();
-}
-
-void hdl_map_req(XEvent *xev) {
-    Window w = xev->xmaprequest.window;
-    XWindowAttributes win_attr;
-
-    if (!XGetWindowAttributes(dpy, w, &win_attr))
+    XMappingEvent *ev = &xev->xmapping;
+    if (ev->request == MappingPointer)
         return;
+    XRefreshKeyboardMapping(ev);
 
-    /* skips invisible windows */
-    if (win_attr.override_redirect || win_attr.width <= 0 ||
-        win_attr.height <= 0) {
-        XMapWindow(dpy, w);
+    Mask old_numlock = numlock_mask;
+    Mask old_mode_switch = mode_switch_mask;
+    update_modifier_masks();
+    if (numlock_mask != old_numlock || mode_switch_mask != old_mode_switch) {
+        grab_keys();
         return;
     }
+    if (ev->request != MappingKeyboard)
+        return;
 
-    /* check if this window is already managed on any workspace */
-    client_t *c = find_client(w);
-    if (c) {
-        if (c->ws == current_ws) {
-            if (!c->mapped) {
-                XMapWindow(dpy, w);
-                c->mapped = True;
-                /* Re-insert into BSP tree beside the focused client */
-                if (!c->floating && !c->fullscreen) {
-                    client_t *split_target =
-                        (focused && focused != c) ? focused : NULL;
-                    bsp_insert(&bsp_roots[current_ws], split_target, c);
-                }
-            }
-            if (user_config.new_win_focus) {
-                focused = c;
-                set_input_focus(c, True, True);
-                return; /* set_input_focus already calls update_borders */
-            }
-            update_borders();
-        }
+    KeyCode codes[MAX_ITEMS];
+    Bool moved = False;
+    /* release every stale grab before taking new ones, two bindings may
+     * have swapped keycodes */
+    for (int i = 0; i < user_config.n_binds; i++) {
+        binding_t *bind = &user_config.binds[i];
+        if (!bind_grabbable(bind))
+            continue;
+        codes[i] = XKeysymToKeycode(dpy, bind->keysym);
+        if (codes[i] == bind->keycode)
+            continue;
+        if (bind->keycode)
+            grab_keycode(bind->keycode, bind->mods, False);
+        moved = True;
+    }
+    if (!moved)
         return;
+
+    for (int i = 0; i < user_config.n_binds; i++) {
+        binding_t *bind = &user_config.binds[i];
+        if (!bind_grabbable(bind) || codes[i] == bind->keycode)
+            continue;
+        bind->keycode = codes[i];
+        if (bind->keycode)
+            grab_keycode(bind->keycode, bind->mods, True);
     }
+    key_table_build(&root_keys, user_config.binds, user_config.n_binds);
+}
 
-    Atom type;
-    int format;
-    unsigned long n_items, after;
-    Atom *types = NULL;
-    Bool should_float = False;
+/* the autostart batch has settled, its windows go up in one layout. they
+ * are laid out before they map, so the ones that end up covered with
+ * COVER_UNMAP stay unmapped */
+static void map_deferred(void) {
+    launch_batch(False);
+    tile();
+    for (int i = 0; i < n_deferred; i++) {
+        client_t *c = find_client(deferred[i]);
+        if (!c || !c->mapped || !ws_visible(c->ws) ||
+            c->hidden == COVER_UNMAP)
+            continue;
+        if (c->floating)
+            XRaiseWindow(dpy, c->win);
+        XMapWindow(dpy, c->win);
+    }
+    n_deferred = 0;
+    set_input_focus(focused, False, False);
+}
 
-    if (XGetWindowProperty(dpy, w, atoms[ATOM_NET_WM_WINDOW_TYPE], 0, 4, False,
-                           XA_ATOM, &type, &format, &n_items, &after,
-                           (unsigned char **)&types) == Success &&
-        types) {
+/* takes over a window that is not managed yet, q holds what the server said
+ * about it */
+static void manage_window(Window w, const win_query_t *q) {
+    /* skips invisible windows */
+    if (q->override_redirect || q->w <= 0 || q->h <= 0) {
+        XMapWindow(dpy, w);
+        return;
+    }
 
-        for (unsigned long i = 0; i < n_items; i++) {
-            if (types[i] == atoms[ATOM_NET_WM_WINDOW_TYPE_DOCK]) {
-                XFree(types);
-                XMapWindow(dpy, w);
-                return;
-            }
+    Bool should_float = False;
+    for (int i = 0; i < q->n_types; i++) {
+        Atom t = q->types[i];
+        if (t == atoms[ATOM_NET_WM_WINDOW_TYPE_DOCK]) {
+            XMapWindow(dpy, w);
+            return;
+        }
 
-            if (types[i] == atoms[ATOM_NET_WM_WINDOW_TYPE_UTILITY] ||
-                types[i] == atoms[ATOM_NET_WM_WINDOW_TYPE_DIALOG] ||
-                types[i] == atoms[ATOM_NET_WM_WINDOW_TYPE_TOOLBAR] ||
-                types[i] == atoms[ATOM_NET_WM_WINDOW_TYPE_SPLASH] ||
-                types[i] == atoms[ATOM_NET_WM_WINDOW_TYPE_POPUP_MENU] ||
-                types[i] == atoms[ATOM_NET_WM_WINDOW_TYPE_DROPDOWN_MENU] ||
-                types[i] == atoms[ATOM_NET_WM_WINDOW_TYPE_MENU] ||
-                types[i] == atoms[ATOM_NET_WM_WINDOW_TYPE_TOOLTIP] ||
-                types[i] == atoms[ATOM_NET_WM_WINDOW_TYPE_NOTIFICATION]) {
-                should_float = True;
-                break;
-            }
+        if (t == atoms[ATOM_NET_WM_WINDOW_TYPE_UTILITY] ||
+            t == atoms[ATOM_NET_WM_WINDOW_TYPE_DIALOG] ||
+            t == atoms[ATOM_NET_WM_WINDOW_TYPE_TOOLBAR] ||
+            t == atoms[ATOM_NET_WM_WINDOW_TYPE_SPLASH] ||
+            t == atoms[ATOM_NET_WM_WINDOW_TYPE_POPUP_MENU] ||
+            t == atoms[ATOM_NET_WM_WINDOW_TYPE_DROPDOWN_MENU] ||
+            t == atoms[ATOM_NET_WM_WINDOW_TYPE_MENU] ||
+            t == atoms[ATOM_NET_WM_WINDOW_TYPE_TOOLTIP] ||
+            t == atoms[ATOM_NET_WM_WINDOW_TYPE_NOTIFICATION]) {
+            should_float = True;
+            break;
         }
-        XFree(types);
     }
 
     if (open_windows == MAX_CLIENTS) {
@@ -926,24 +1317,32 @@ void hdl_map_req(XEvent *xev) {
         return;
     }
 
-    int target_ws = get_workspace_for_window(w);
-    c = add_client(w, target_ws);
+    /* only a window that gets managed uses up its launch's match, a dock or
+     * a refused window would send the real one to the wrong workspace */
+    Bool from_batch;
+    int launch_ws = launch_mapped(q->pid, q->startup_id, &from_batch);
+
+    /* everything a rule changes is settled before the first layout */
+    rule_action_t rule;
+    rules_apply(q, &rule);
+    if (rule.floating || rule.sticky || rule.w > 0)
+        should_float = True;
+
+    int target_ws = launch_ws >= 0 ? launch_ws
+                    : rule.ws >= 0 ? rule.ws
+                                   : get_workspace_for_window(q);
+    client_t *c = add_client(w, target_ws, q);
     if (!c)
         return;
+    c->sticky = rule.sticky;
     set_wm_state(w, NormalState);
 
-    Window transient;
-    if (!should_float && XGetTransientForHint(dpy, w, &transient))
+    if (!should_float && q->transient != None)
         should_float = True;
 
-    XSizeHints size_hints;
-    long supplied_ret;
-
-    if (!should_float &&
-        XGetWMNormalHints(dpy, w, &size_hints, &supplied_ret) &&
-        (size_hints.flags & PMinSize) && (size_hints.flags & PMaxSize) &&
-        size_hints.min_width == size_hints.max_width &&
-        size_hints.min_height == size_hints.max_height) {
+    if (!should_float && (q->hint_flags & PMinSize) &&
+        (q->hint_flags & PMaxSize) && q->min_w == q->max_w &&
+        q->min_h == q->max_h) {
 
         should_float = True;
         c->fixed = True;
@@ -954,10 +1353,14 @@ void hdl_map_req(XEvent *xev) {
         bsp_remove(&bsp_roots[target_ws], c);
     }
 
-    /* center floating windows & set border */
+    /* place floating windows where their rule says, else centred, & set
+     * border */
     if (c->floating && !c->fullscreen) {
-        int w_ = MAX(c->w, 64), h_ = MAX(c->h, 64);
-        int x = (scr_width - w_) / 2, y = (scr_height - h_) / 2;
+        monitor_t *mon = &monitors[ws_mon[target_ws]];
+        int w_ = rule.w > 0 ? rule.w : MAX(c->w, 64);
+        int h_ = rule.w > 0 ? rule.h : MAX(c->h, 64);
+        int x = mon->x + (rule.w > 0 ? rule.x : (mon->w - w_) / 2);
+        int y = mon->y + (rule.w > 0 ? rule.y : (mon->h - h_) / 2);
         c->x = x;
         c->y = y;
         c->w = w_;
@@ -966,9 +1369,30 @@ void hdl_map_req(XEvent *xev) {
         XSetWindowBorderWidth(dpy, w, user_config.border_width);
     }
 
+    /* straight to fullscreen, it is never tiled first */
+    if (q->fullscreen || rule.fullscreen) {
+        c->orig_x = c->x;
+        c->orig_y = c->y;
+        c->orig_w = c->w;
+        c->orig_h = c->h;
+        enter_fullscreen(c);
+    }
+
+    /* scan_existing_windows lays everything out once it is done */
+    if (adopting) {
+        set_frame_extents(w);
+        return;
+    }
+
     update_net_client_list();
-    if (target_ws != current_ws)
+    if (!ws_visible(target_ws))
+        return;
+
+    if (from_batch && launch_batch_wait() > 0 && n_deferred < MAX_CLIENTS) {
+        deferred[n_deferred++] = w;
+        set_frame_extents(w);
         return;
+    }
 
     /* map & borders */
     if (!global_floating && !c->floating)
@@ -976,19 +1400,23 @@ void hdl_map_req(XEvent *xev) {
     else if (c->floating)
         XRaiseWindow(dpy, w);
 
-    if (window_has_ewmh_state(w, atoms[ATOM_NET_WM_STATE_FULLSCREEN])) {
-        c->fullscreen = True;
-        c->floating = False;
-        bsp_remove(&bsp_roots[target_ws], c);
-    }
-
-    XMapWindow(dpy, w);
+    /* a new tiled window goes under a fullscreen one, which covers it */
+    client_t *fs = ws_fullscreen(target_ws);
+    Bool under_fs = fs && fs != c && !c->floating;
+    if (under_fs)
+        XConfigureWindow(dpy, w, CWSibling | CWStackMode,
+                         &(XWindowChanges){.sibling = fs->win,
+                                           .stack_mode = Below});
+
+    /* tile() may have just put it away under a cover, then it only maps
+     * once the cover goes */
+    if (c->hidden != COVER_UNMAP)
+        XMapWindow(dpy, w);
     c->mapped = True;
-    if (c->fullscreen)
-        apply_fullscreen(c, True);
     set_frame_extents(w);
 
-    if (user_config.new_win_focus) {
+    /* nor does it take the focus from the window covering it */
+    if (user_config.new_win_focus && !rule.no_focus && !under_fs) {
         focused = c;
         set_input_focus(focused, True, True);
         return;
@@ -996,6 +1424,41 @@ void hdl_map_req(XEvent *xev) {
     update_borders();
 }
 
+void hdl_map_req(XEvent *xev) {
+    Window w = xev->xmaprequest.window;
+
+    /* check if this window is already managed on any workspace */
+    client_t *c = find_client(w);
+    if (c) {
+        if (ws_visible(c->ws)) {
+            if (!c->mapped) {
+                XMapWindow(dpy, w);
+                c->mapped = True;
+                /* Re-insert into BSP tree beside the focused client */
+                if (!c->floating && !c->fullscreen) {
+                    client_t *split_target =
+                        (focused && focused != c && focused->ws == c->ws)
+                            ? focused
+                            : NULL;
+                    bsp_insert(&bsp_roots[c->ws], split_target, c);
+                }
+            }
+            if (user_config.new_win_focus) {
+                focused = c;
+                set_input_focus(c, True, True);
+                return; /* set_input_focus already calls update_borders */
+            }
+            update_borders();
+        }
+        return;
+    }
+
+    win_query_t q;
+    query_windows(&w, 1, &q);
+    if (q.valid)
+        manage_window(w, &q);
+}
+
 void hdl_motion(XEvent *xev) {
     XMotionEvent *motion_ev = &xev->xmotion;
 
@@ -1057,16 +1520,19 @@ void hdl_motion(XEvent *xev) {
         int outer_w = drag_client->w + 2 * user_config.border_width;
         int outer_h = drag_client->h + 2 * user_config.border_width;
 
-        int rel_x = nx;
-        int rel_y = ny;
+        /* snap to the edges of the monitor the window is over */
+        int mon = monitor_at(nx + outer_w / 2, ny + outer_h / 2);
+        monitor_t *m = &monitors[mon >= 0 ? mon : ws_mon[drag_client->ws]];
+        int rel_x = nx - m->x;
+        int rel_y = ny - m->y;
 
-        rel_x = snap_coordinate(rel_x, outer_w, scr_width,
+        rel_x = snap_coordinate(rel_x, outer_w, m->w,
                                 user_config.snap_distance);
-        rel_y = snap_coordinate(rel_y, outer_h, scr_height,
+        rel_y = snap_coordinate(rel_y, outer_h, m->h,
                                 user_config.snap_distance);
 
-        nx = rel_x;
-        ny = rel_y;
+        nx = rel_x + m->x;
+        ny = rel_y + m->y;
 
         if (!drag_client->floating &&
             (UDIST(nx, drag_client->x) > user_config.snap_distance ||
@@ -1083,8 +1549,9 @@ void hdl_motion(XEvent *xev) {
         int nw = drag_orig_w + dx;
         int nh = drag_orig_h + dy;
 
-        int max_w = (scr_width - drag_client->x);
-        int max_h = (scr_height - drag_client->y);
+        monitor_t *m = &monitors[ws_mon[drag_client->ws]];
+        int max_w = (m->x + m->w - drag_client->x);
+        int max_h = (m->y + m->h - drag_client->y);
 
         drag_client->w = CLAMP(nw, MIN_WINDOW_SIZE, max_w);
         drag_client->h = CLAMP(nh, MIN_WINDOW_SIZE, max_h);
@@ -1127,20 +1594,31 @@ void hdl_property_ntf(XEvent *xev) {
             window_has_ewmh_state(c->win, atoms[ATOM_NET_WM_STATE_FULLSCREEN]);
         if (want != c->fullscreen)
             apply_fullscreen(c, want);
+    } else if (property_ev->atom == XA_WM_NORMAL_HINTS) {
+        client_t *c = find_client(property_ev->window);
+        if (!c)
+            return;
+
+        win_query_t q;
+        query_hints(c->win, &q);
+        cache_hints(c, &q);
+        if (c->mapped && !c->floating && !c->fullscreen && ws_visible(c->ws))
+            tile_ws(c->ws);
     }
 }
 
 void hdl_unmap_ntf(XEvent *xev) {
+    client_t *c = find_client(xev->xunmap.window);
+    /* monocle put it away itself */
+    if (c && c->hidden == COVER_UNMAP && !xev->xunmap.send_event)
+        return;
+
     if (!in_ws_switch) {
-        Window w = xev->xunmap.window;
-        for (client_t *c = workspaces[current_ws]; c; c = c->next) {
-            if (c->win == w && c->mapped) {
-                c->mapped = False;
-                /* Remove from BSP so tile() doesn't see a stale leaf */
-                if (!c->floating && !c->fullscreen)
-                    bsp_remove(&bsp_roots[current_ws], c);
-                break;
-            }
+        if (c && c->mapped && ws_visible(c->ws)) {
+            c->mapped = False;
+            /* Remove from BSP so tile() doesn't see a stale leaf */
+            if (!c->floating && !c->fullscreen)
+                bsp_remove(&bsp_roots[c->ws], c);
         }
     }
 
@@ -1155,31 +1633,56 @@ void inc_gaps(void) {
     update_borders();
 }
 
-static bsp_node_t *bsp_find_leaf(bsp_node_t *node, client_t *c) {
-    if (!node)
-        return NULL;
-    if (node->type == BSP_LEAF)
-        return (node->client == c) ? node : NULL;
-    bsp_node_t *r = bsp_find_leaf(node->first, c);
-    return r ? r : bsp_find_leaf(node->second, c);
+static unsigned int key_slot(unsigned int key) {
+    return (key * 2654435761u) >> (32 - KEY_SLOTS_BITS);
 }
 
-static void bsp_swap_leaves(bsp_node_t *root, client_t *a, client_t *b) {
-    bsp_node_t *la = bsp_find_leaf(root, a);
-    bsp_node_t *lb = bsp_find_leaf(root, b);
-    if (!la || !lb)
-        return;
-    la->client = b;
-    lb->client = a;
+/* only binds that are grabbed go in, the first of two equal ones wins just
+ * like it would in a scan */
+void key_table_build(key_table_t *t, binding_t *binds, int n) {
+    memset(t->bind, 0, sizeof(t->bind));
+    for (int i = 0; i < n; i++) {
+        binding_t *b = &binds[i];
+        if (!b->keycode || !bind_grabbable(b))
+            continue;
+        unsigned int key = (unsigned int)b->keycode << 16 | clean_mask(b->mods);
+        unsigned int slot = key_slot(key);
+        while (t->bind[slot] && t->key[slot] != key)
+            slot = (slot + 1) & (KEY_SLOTS - 1);
+        if (!t->bind[slot]) {
+            t->key[slot] = key;
+            t->bind[slot] = b;
+        }
+    }
+}
+
+binding_t *key_table_find(const key_table_t *t, KeyCode code, int mods) {
+    unsigned int key = (unsigned int)code << 16 | (unsigned int)mods;
+    for (unsigned int slot = key_slot(key); t->bind[slot];
+         slot = (slot + 1) & (KEY_SLOTS - 1))
+        if (t->key[slot] == key)
+            return t->bind[slot];
+    return NULL;
 }
 
 static void move_focused_dir(int dir) {
     if (!focused || !workspaces[current_ws])
         return;
 
-    client_t *nb = bsp_find_neighbor(focused, dir);
-    if (!nb)
+    client_t *nb = bsp_find_neighbor(workspaces[current_ws], focused, dir);
+    if (!nb) {
+        /* off the edge of this tree, the window goes to the next monitor */
+        int mon = monitor_neighbor(ws_mon[current_ws], dir);
+        if (mon < 0 || focused->floating || focused->fullscreen)
+            return;
+        client_t *moved = focused;
+        int ws = monitors[mon].ws;
+        nb = bsp_find_neighbor(workspaces[ws], moved, dir);
+        relocate_client(moved, ws, nb ? nb : ws_focused[ws]);
+        tile();
+        set_input_focus(moved, False, True);
         return;
+    }
 
     bsp_swap_leaves(bsp_roots[current_ws], focused, nb);
     swap_clients(focused, nb);
@@ -1197,37 +1700,16 @@ void move_focused_up(void) { move_focused_dir(2); }
 void move_focused_down(void) { move_focused_dir(3); }
 
 void move_to_workspace(int ws) {
-    if (!focused || ws >= NUM_WORKSPACES || ws == current_ws)
+    if (!focused || ws < 0 || ws >= NUM_WORKSPACES || ws == current_ws)
         return;
 
     client_t *moved = focused;
     int from_ws = current_ws;
 
-    XUnmapWindow(dpy, moved->win);
-
-    /* remove from current list */
-    client_t **pp = &workspaces[from_ws];
-    while (*pp && *pp != moved)
-        pp = &(*pp)->next;
-
-    if (*pp)
-        *pp = moved->next;
-
-    /* update BSP trees */
-    bsp_remove(&bsp_roots[from_ws], moved);
-    if (!moved->floating && !moved->fullscreen)
-        bsp_insert(&bsp_roots[ws], NULL, moved);
-
-    /* push to target list */
-    moved->next = workspaces[ws];
-    workspaces[ws] = moved;
-    moved->ws = ws;
-    long desktop = ws;
-    XChangeProperty(dpy, moved->win, atoms[ATOM_NET_WM_DESKTOP], XA_CARDINAL,
-                    32, PropModeReplace, (unsigned char *)&desktop, 1);
-
-    /* remember it as last-focused for the target workspace */
-    ws_focused[ws] = moved;
+    /* a workspace on another monitor takes it as it is */
+    if (!ws_visible(ws))
+        XUnmapWindow(dpy, moved->win);
+    relocate_client(moved, ws, NULL);
 
     /* retile current workspace and pick a new focus there */
     tile();
@@ -1320,6 +1802,29 @@ void quit(void) {
     }
     */
 
+    ipc_cleanup();
+    shm_cleanup();
+    record_close();
+    rc_cleanup();
+
+    /* hand everything back so leak checkers only report real leaks */
+    for (int ws = 0; ws < NUM_WORKSPACES; ws++) {
+        bsp_free(&bsp_roots[ws]);
+        ws_focused[ws] = NULL;
+        while (workspaces[ws]) {
+            client_t *next = workspaces[ws]->next;
+            free(workspaces[ws]);
+            workspaces[ws] = next;
+        }
+    }
+    focused = NULL;
+    for (int i = 0; i < user_config.n_binds; i++)
+        if (user_config.binds[i].type == TYPE_CMD)
+            free_pipeline(user_config.binds[i].action.cmd);
+    user_config.n_binds = 0;
+    for (int i = 0; i < user_config.n_to_run; i++)
+        free_pipeline(user_config.to_run[i].cmd);
+    user_config.n_to_run = 0;
     XSync(dpy, False);
     XFreeCursor(dpy, cursor_move);
     XFreeCursor(dpy, cursor_normal);
@@ -1333,8 +1838,9 @@ void resize_win_down(void) {
     if (!focused || !focused->floating)
         return;
 
+    monitor_t *mon = &monitors[ws_mon[focused->ws]];
     int new_h = focused->h + user_config.resize_window_amt;
-    int max_h = scr_height - focused->y;
+    int max_h = mon->y + mon->h - focused->y;
     focused->h = CLAMP(new_h, MIN_WINDOW_SIZE, max_h);
     XResizeWindow(dpy, focused->win, focused->w, focused->h);
 }
@@ -1352,8 +1858,9 @@ void resize_win_right(void) {
     if (!focused || !focused->floating)
         return;
 
+    monitor_t *mon = &monitors[ws_mon[focused->ws]];
     int new_w = focused->w + user_config.resize_window_amt;
-    int max_w = scr_width - focused->x;
+    int max_w = mon->x + mon->w - focused->x;
     focused->w = CLAMP(new_w, MIN_WINDOW_SIZE, max_w);
     XResizeWindow(dpy, focused->win, focused->w, focused->h);
 }
@@ -1367,12 +1874,87 @@ void resize_win_left(void) {
     XResizeWindow(dpy, focused->win, focused->w, focused->h);
 }
 
+/* re-execs tilite with the layout handed over through an unlinked file */
+void restart(void) {
+#ifdef TILITE_REPLAY
+    /* a replay has no process to hand over to */
+    return;
+#endif
+    FILE *f = tmpfile();
+    if (!f || restart_save(f) < 0) {
+        fprintf(stderr, "tilite: cannot save state, not restarting\n");
+        if (f)
+            fclose(f);
+        return;
+    }
+    rewind(f);
+
+    int fd = dup(fileno(f));
+    fclose(f);
+    if (fd < 0) {
+        perror("tilite: restart");
+        return;
+    }
+
+    char fd_arg[16];
+    snprintf(fd_arg, sizeof(fd_arg), "%d", fd);
+    char *const argv[] = {self_path, "-R", fd_arg, NULL};
+
+    ipc_cleanup();
+    shm_cleanup();
+    record_close();
+    rc_cleanup();
+    XCloseDisplay(dpy);
+    execvp(self_path, argv);
+
+    /* nothing left to go back to */
+    perror("tilite: restart");
+    exit(EXIT_FAILURE);
+}
+
 void run(void) {
     running = True;
     XEvent xev;
+    struct pollfd pfds[4 + IPC_MAX_CONNS];
+
     while (running) {
-        XNextEvent(dpy, &xev);
-        xev_case(&xev);
+        /* drain everything xlib already has queued before sleeping */
+        while (running && XPending(dpy)) {
+            XNextEvent(dpy, &xev);
+            xev_case(&xev);
+        }
+        if (!running)
+            break;
+
+        /* the autostart windows stopped coming, show them all at once */
+        int settle = launch_batch_wait();
+        if (settle == 0) {
+            map_deferred();
+            settle = -1;
+        }
+
+        STATS_POLL();
+        TRACE_POLL();
+        shm_update();
+        ipc_flush();
+        record_flush();
+
+        pfds[0] = (struct pollfd){.fd = ConnectionNumber(dpy), .events = POLLIN};
+        int n_ipc = ipc_pollfds(pfds + 1);
+        int n_rc = rc_pollfd(pfds + 1 + n_ipc);
+        int n_fds = 1 + n_ipc + n_rc;
+        n_fds += launch_pollfd(pfds + n_fds);
+        if (poll(pfds, n_fds, settle) < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("tilite: poll");
+            break;
+        }
+        ipc_dispatch(pfds + 1, n_ipc);
+        if (n_rc)
+            rc_dispatch(&pfds[1 + n_ipc]);
+        if (n_fds > 1 + n_ipc + n_rc)
+            launch_dispatch(&pfds[1 + n_ipc + n_rc]);
     }
 }
 
@@ -1382,22 +1964,51 @@ void scan_existing_windows(void) {
     Window *children;
     unsigned int n_children;
 
-    if (XQueryTree(dpy, root, &root_return, &parent_return, &children,
-                   &n_children)) {
+    if (!XQueryTree(dpy, root, &root_return, &parent_return, &children,
+                    &n_children))
+        return;
+
+    /* ask about every child at once, then adopt the viewable ones onto the
+     * workspace their _NET_WM_DESKTOP names */
+    win_query_t *qs = n_children ? malloc(n_children * sizeof(*qs)) : NULL;
+    if (qs) {
+        query_windows(children, n_children, qs);
+        adopting = True;
         for (unsigned int i = 0; i < n_children; i++) {
-            XWindowAttributes wa;
-            if (!XGetWindowAttributes(dpy, children[i], &wa) ||
-                wa.override_redirect || wa.map_state != IsViewable)
+            if (!qs[i].valid || qs[i].override_redirect ||
+                qs[i].map_state != IsViewable || find_client(children[i]))
                 continue;
+            manage_window(children[i], &qs[i]);
+        }
+        adopting = False;
+        free(qs);
+    }
+    if (children)
+        XFree(children);
 
-            XEvent fake_event = {None};
-            fake_event.type = MapRequest;
-            fake_event.xmaprequest.window = children[i];
-            hdl_map_req(&fake_event);
+    /* hide the workspaces no monitor shows without an UnmapNotify, and so a
+     * relayout, for every window */
+    XGrabServer(dpy);
+    select_input(root, ROOT_EVENT_MASK & ~SubstructureNotifyMask);
+    for (int ws = 0; ws < NUM_WORKSPACES; ws++) {
+        if (ws_visible(ws))
+            continue;
+        for (client_t *c = workspaces[ws]; c; c = c->next) {
+            select_input(c->win, CLIENT_EVENT_MASK & ~StructureNotifyMask);
+            XUnmapWindow(dpy, c->win);
+            select_input(c->win, CLIENT_EVENT_MASK);
         }
-        if (children)
-            XFree(children);
     }
+    select_input(root, ROOT_EVENT_MASK);
+    XUngrabServer(dpy);
+
+    /* one layout per workspace */
+    update_net_client_list();
+    update_struts();
+    for (int ws = 0; ws < NUM_WORKSPACES; ws++)
+        if (workspaces[ws])
+            tile_ws(ws);
+    set_input_focus(focused, False, False);
 }
 
 void select_input(Window w, Mask masks) { XSelectInput(dpy, w, masks); }
@@ -1430,10 +2041,17 @@ void setup(void) {
         exit(EXIT_FAILURE);
     }
     root = XDefaultRootWindow(dpy);
+    /* spawned programs must not inherit the connection */
+    fcntl(ConnectionNumber(dpy), F_SETFD, FD_CLOEXEC);
+    scr_width = XDisplayWidth(dpy, DefaultScreen(dpy));
+    scr_height = XDisplayHeight(dpy, DefaultScreen(dpy));
+    monitor_init();
 
     setup_atoms();
     other_wm();
-    load_config();
+    load_config(&user_config);
+    rc_init();
+    rules_build(&user_config);
     update_modifier_masks();
     grab_keys();
 
@@ -1442,25 +2060,10 @@ void setup(void) {
     cursor_resize = XcursorLibraryLoadCursor(dpy, "bottom_right_corner");
     XDefineCursor(dpy, root, cursor_normal);
 
-    scr_width = XDisplayWidth(dpy, DefaultScreen(dpy));
-    scr_height = XDisplayHeight(dpy, DefaultScreen(dpy));
-
     /* select events wm should look for on root */
-    Mask wm_masks = StructureNotifyMask | SubstructureRedirectMask |
-                    SubstructureNotifyMask | KeyPressMask | PropertyChangeMask;
-    select_input(root, wm_masks);
+    select_input(root, ROOT_EVENT_MASK);
 
-    /* grab mouse button events on root window */
-    Mask root_click_masks =
-        ButtonPressMask | ButtonReleaseMask | PointerMotionMask;
-    Mask root_swap_masks =
-        ButtonPressMask | ButtonReleaseMask | PointerMotionMask;
-    Mask root_resize_masks =
-        ButtonPressMask | ButtonReleaseMask | PointerMotionMask;
-    grab_button(Button1, user_config.modkey, root, True, root_click_masks);
-    grab_button(Button1, user_config.modkey | ShiftMask, root, True,
-                root_swap_masks);
-    grab_button(Button3, user_config.modkey, root, True, root_resize_masks);
+    grab_root_buttons();
     XSync(dpy, False);
 
     for (int i = 0; i < LASTEvent; i++)
@@ -1477,10 +2080,28 @@ void setup(void) {
     evtable[MotionNotify] = hdl_motion;
     evtable[PropertyNotify] = hdl_property_ntf;
     evtable[UnmapNotify] = hdl_unmap_ntf;
+    ipc_init();
+    shm_init();
+    STATS_INIT();
+    TRACE_INIT();
+    if (restore_fd >= 0 && restart_load(restore_fd) < 0)
+        fprintf(stderr, "tilite: cannot restore state, starting fresh\n");
     scan_existing_windows();
 
-    /* prevent child processes from becoming zombies */
-    signal(SIGCHLD, SIG_IGN);
+    /* children are reaped through the event loop */
+    launch_init();
+
+    /* what we spawn gets neither our blocked SIGCHLD nor, if launch_init
+     * had to fall back to it, our SIG_IGN */
+    sigset_t none, chld;
+    sigemptyset(&none);
+    sigemptyset(&chld);
+    sigaddset(&chld, SIGCHLD);
+    posix_spawnattr_init(&spawn_attr);
+    posix_spawnattr_setsigmask(&spawn_attr, &none);
+    posix_spawnattr_setsigdefault(&spawn_attr, &chld);
+    posix_spawnattr_setflags(&spawn_attr,
+                             POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
 }
 
 void setup_atoms(void) {
@@ -1514,8 +2135,9 @@ void setup_atoms(void) {
                     atoms[ATOM_UTF8_STRING], 8, PropModeReplace,
                     (const unsigned char *)workspace_names, names_len);
 
+    long current_desktop = current_ws;
     XChangeProperty(dpy, root, atoms[ATOM_NET_CURRENT_DESKTOP], XA_CARDINAL, 32,
-                    PropModeReplace, (const unsigned char *)&current_ws, 1);
+                    PropModeReplace, (const unsigned char *)&current_desktop, 1);
 
     /* load supported list */
     XChangeProperty(dpy, root, atoms[ATOM_NET_SUPPORTED], XA_ATOM, 32,
@@ -1524,6 +2146,15 @@ void setup_atoms(void) {
     update_workarea();
 }
 
+/* makes ws, which a monitor already shows, the focused workspace */
+void set_current_ws(int ws) {
+    current_ws = ws;
+    long current_desktop = current_ws;
+    XChangeProperty(dpy, root, atoms[ATOM_NET_CURRENT_DESKTOP], XA_CARDINAL, 32,
+                    PropModeReplace, (unsigned char *)&current_desktop, 1);
+    ipc_notify(IPC_EV_WORKSPACE, None, current_ws);
+}
+
 void set_frame_extents(Window w) {
     long extents[4] = {user_config.border_width, user_config.border_width,
                        user_config.border_width, user_config.border_width};
@@ -1532,12 +2163,22 @@ void set_frame_extents(Window w) {
 }
 
 void set_input_focus(client_t *c, Bool raise_win, Bool warp) {
+    TRACE_SCOPE("focus", "set_input_focus");
     if (c && c->mapped) {
+        /* focusing a window on another monitor moves there */
+        if (c->ws != current_ws && ws_visible(c->ws)) {
+            ws_focused[current_ws] = focused;
+            set_current_ws(c->ws);
+        }
         focused = c;
 
         /* update remembered focus */
         if (c->ws >= 0 && c->ws < NUM_WORKSPACES)
             ws_focused[c->ws] = c;
+        /* monocle only sizes and shows the window on top */
+        if (monocle && !c->floating && !c->fullscreen &&
+            c->win != monocle_top[c->ws])
+            tile_ws(c->ws);
 
         Window w = find_toplevel(c->win);
 
@@ -1552,6 +2193,7 @@ void set_input_focus(client_t *c, Bool raise_win, Bool warp) {
         /* EWMH focus hint */
         XChangeProperty(dpy, root, atoms[ATOM_NET_ACTIVE_WINDOW], XA_WINDOW, 32,
                         PropModeReplace, (unsigned char *)&w, 1);
+        ipc_notify(IPC_EV_FOCUS, c->win, c->ws);
 
         update_borders();
 
@@ -1564,6 +2206,7 @@ void set_input_focus(client_t *c, Bool raise_win, Bool warp) {
 
         focused = NULL;
         ws_focused[current_ws] = NULL;
+        ipc_notify(IPC_EV_FOCUS, None, current_ws);
         update_borders();
     }
 
@@ -1584,132 +2227,69 @@ int snap_coordinate(int pos, int size, int screen_size, int snap_dist) {
     return pos;
 }
 
-void spawn(const char *const *argv) {
+/* posix_spawn shares the address space until the exec, so a launch never
+ * copies the wm's page tables. one stage needs no file actions and so, past
+ * the first launch, no allocation at all. ws is where the first window
+ * goes, -1 for wherever it would anyway */
+void spawn(const pipeline_t *p, int ws) {
+    TRACE_SCOPE("spawn", "spawn");
+#ifdef TILITE_REPLAY
+    /* a replay must never launch the recorded session's programs */
+    (void)p;
+    (void)ws;
+    return;
+#endif
+    if (!p)
+        return;
+
     // release keyboard to support lock screen keybind
     XUngrabKeyboard(dpy, CurrentTime);
     XUngrabPointer(dpy, CurrentTime);
     XFlush(dpy);
 
-    int argc = 0;
-    while (argv[argc])
-        argc++;
-
-    int cmd_count = 1;
-    for (int i = 0; i < argc; i++) {
-        if (strcmp(argv[i], "|") == 0)
-            cmd_count++;
-    }
-
-    const char ***commands = malloc(cmd_count * sizeof(char **)); /* *** bruh */
-    if (!commands) {
-        perror("malloc commands");
-        return;
-    }
-
-    /* initialize all command pointers to NULL for safe cleanup */
-    for (int i = 0; i < cmd_count; i++)
-        commands[i] = NULL;
-
-    int cmd_idx = 0;
-    int arg_start = 0;
-    for (int i = 0; i <= argc; i++) {
-        if (!argv[i] || strcmp(argv[i], "|") == 0) {
-            int len = i - arg_start;
-            const char **cmd_args = malloc((len + 1) * sizeof(char *));
-
-            if (!cmd_args) {
-                perror("malloc cmd_args");
-
-                for (int j = 0; j < cmd_idx; j++)
-                    free(commands[j]);
-
-                free(commands);
-                return;
+    char *const *envp = launch_start(p, ws);
+    int in = -1;
+    for (int i = 0; i < p->n_stages; i++) {
+        int fds[2] = {-1, -1};
+        if (i < p->n_stages - 1) {
+            if (pipe(fds) == -1) {
+                perror("pipe");
+                break;
             }
-
-            for (int j = 0; j < len; j++)
-                cmd_args[j] = argv[arg_start + j];
-
-            cmd_args[len] = NULL;
-            commands[cmd_idx++] = cmd_args;
-            arg_start = i + 1;
-        }
-    }
-
-    int (*pipes)[2] = malloc(sizeof(int[2]) * (cmd_count - 1));
-    if (!pipes) {
-        perror("malloc pipes");
-
-        for (int j = 0; j < cmd_count; j++)
-            free(commands[j]);
-
-        free(commands);
-        return;
-    }
-
-    for (int i = 0; i < cmd_count - 1; i++) {
-        if (pipe(pipes[i]) == -1) {
-            perror("pipe");
-
-            for (int j = 0; j < cmd_count; j++)
-                free(commands[j]);
-
-            free(commands);
-            free(pipes);
-            return;
+            /* only the dup2'd copies reach the children */
+            fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+            fcntl(fds[1], F_SETFD, FD_CLOEXEC);
         }
-    }
 
-    for (int i = 0; i < cmd_count; i++) {
-        if (!commands[i] || !commands[i][0])
-            continue;
-
-        pid_t pid = fork();
-        if (pid < 0) {
-            perror("fork");
-
-            for (int k = 0; k < cmd_count - 1; k++) {
-                close(pipes[k][0]);
-                close(pipes[k][1]);
-            }
-
-            for (int j = 0; j < cmd_count; j++)
-                free(commands[j]);
-
-            free(commands);
-            free(pipes);
-            return;
+        posix_spawn_file_actions_t fa, *fap = NULL;
+        if (in >= 0 || fds[1] >= 0) {
+            fap = &fa;
+            posix_spawn_file_actions_init(fap);
+            if (in >= 0)
+                posix_spawn_file_actions_adddup2(fap, in, STDIN_FILENO);
+            if (fds[1] >= 0)
+                posix_spawn_file_actions_adddup2(fap, fds[1], STDOUT_FILENO);
         }
-        if (pid == 0) {
-            close(ConnectionNumber(dpy));
-
-            if (i > 0)
-                dup2(pipes[i - 1][0], STDIN_FILENO);
 
-            if (i < cmd_count - 1)
-                dup2(pipes[i][1], STDOUT_FILENO);
+        pid_t pid;
+        char *const *argv = p->stage[i];
+        int err = posix_spawnp(&pid, argv[0], fap, &spawn_attr, argv, envp);
+        launch_track(pid, err);
+        if (err)
+            fprintf(stderr, "tilite: cannot run '%s': %s\n", argv[0],
+                    strerror(err));
+        if (fap)
+            posix_spawn_file_actions_destroy(fap);
 
-            for (int k = 0; k < cmd_count - 1; k++) {
-                close(pipes[k][0]);
-                close(pipes[k][1]);
-            }
-
-            execvp(commands[i][0], (char *const *)(void *)commands[i]);
-            fprintf(stderr, "tilite: execvp '%s' failed\n", commands[i][0]);
-            exit(EXIT_FAILURE);
-        }
-    }
-
-    for (int i = 0; i < cmd_count - 1; i++) {
-        close(pipes[i][0]);
-        close(pipes[i][1]);
+        /* the children hold their own copies now */
+        if (in >= 0)
+            close(in);
+        if (fds[1] >= 0)
+            close(fds[1]);
+        in = fds[0];
     }
-
-    for (int i = 0; i < cmd_count; i++)
-        free(commands[i]);
-
-    free(commands);
-    free(pipes);
+    if (in >= 0)
+        close(in);
 }
 
 void swap_clients(client_t *a, client_t *b) {
@@ -1748,146 +2328,46 @@ void swap_clients(client_t *a, client_t *b) {
     ta->next = tb_next == ta ? tb : tb_next;
 }
 
-static bsp_node_t *bsp_make_leaf(client_t *c) {
-    bsp_node_t *n = calloc(1, sizeof(bsp_node_t));
-    if (!n)
-        return NULL;
-    n->type = BSP_LEAF;
-    n->client = c;
-    return n;
-}
-
-bsp_node_t *bsp_insert(bsp_node_t **root, client_t *old_client,
-                       client_t *new_client) {
-    bsp_node_t *leaf = NULL;
-
-    if (*root == NULL) {
-        *root = bsp_make_leaf(new_client);
-        return *root;
-    }
-
-    leaf = bsp_find_leaf(*root, old_client);
-    if (!leaf) {
-        bsp_node_t *split = calloc(1, sizeof(bsp_node_t));
-        if (!split)
-            return NULL;
-        split->type = BSP_SPLIT_V;
-        split->first = *root;
-        split->second = bsp_make_leaf(new_client);
-        if (split->first)
-            split->first->parent = split;
-        if (split->second)
-            split->second->parent = split;
-        *root = split;
-        return split;
-    }
-
-    bsp_node_t *split = calloc(1, sizeof(bsp_node_t));
-    if (!split)
-        return NULL;
-
-    split->type = BSP_SPLIT_V;
-    split->first = bsp_make_leaf(old_client);
-    split->second = bsp_make_leaf(new_client);
-    if (!split->first || !split->second) {
-        free(split->first);
-        free(split->second);
-        free(split);
-        return NULL;
-    }
-    split->first->parent = split;
-    split->second->parent = split;
-    split->parent = leaf->parent;
-
-    if (!leaf->parent) {
-        *root = split;
-    } else {
-        bsp_node_t *p = leaf->parent;
-        if (p->first == leaf)
-            p->first = split;
-        else
-            p->second = split;
-    }
-    free(leaf);
-    return split;
-}
-
-void bsp_remove(bsp_node_t **root, client_t *c) {
-    if (!*root)
-        return;
-
-    bsp_node_t *leaf = bsp_find_leaf(*root, c);
-    if (!leaf)
-        return;
-
-    if (!leaf->parent) {
-        free(leaf);
-        *root = NULL;
-        return;
-    }
-
-    bsp_node_t *parent = leaf->parent;
-    bsp_node_t *sibling =
-        (parent->first == leaf) ? parent->second : parent->first;
-    bsp_node_t *grandp = parent->parent;
-
-    sibling->parent = grandp;
-    if (!grandp) {
-        *root = sibling;
-    } else {
-        if (grandp->first == parent)
-            grandp->first = sibling;
-        else
-            grandp->second = sibling;
-    }
-    free(leaf);
-    free(parent);
+static void xlib_configure(void *ctx, client_t *c, int x, int y, int w, int h,
+                           int bw) {
+    (void)ctx;
+    XWindowChanges wc = {.x = x,
+                         .y = y,
+                         .width = w,
+                         .height = h,
+                         .border_width = bw};
+    XConfigureWindow(dpy, c->win,
+                     CWX | CWY | CWWidth | CWHeight | CWBorderWidth, &wc);
 }
 
-static void bsp_assign_rects(bsp_node_t *node, int x, int y, int w, int h) {
-    if (!node)
-        return;
+static const layout_backend_t xlib_backend = {xlib_configure, NULL};
 
-    if (node->type == BSP_LEAF) {
-        client_t *c = node->client;
-        if (!c || !c->mapped || c->floating || c->fullscreen)
-            return;
-        int bw = user_config.border_width;
-        XWindowChanges wc = {.x = x,
-                             .y = y,
-                             .width = MAX(1, w - 2 * bw),
-                             .height = MAX(1, h - 2 * bw),
-                             .border_width = bw};
-        if (c->x != wc.x || c->y != wc.y || c->w != wc.width ||
-            c->h != wc.height)
-            XConfigureWindow(dpy, c->win,
-                             CWX | CWY | CWWidth | CWHeight | CWBorderWidth,
-                             &wc);
-        c->x = wc.x;
-        c->y = wc.y;
-        c->w = wc.width;
-        c->h = wc.height;
+/* puts c away under the monocle window as how says, COVER_SHOW brings it
+ * back */
+static void cover_client(client_t *c, int how) {
+    if (c->hidden == how)
         return;
-    }
-
-    int gaps = user_config.gaps;
-
-    if (w >= h) {
-        int lw = (w - gaps) / 2;
-        int rw = w - lw - gaps;
-        bsp_assign_rects(node->first, x, y, lw, h);
-        bsp_assign_rects(node->second, x + lw + gaps, y, rw, h);
-    } else {
-        int th = (h - gaps) / 2;
-        int bh = h - th - gaps;
-        bsp_assign_rects(node->first, x, y, w, th);
-        bsp_assign_rects(node->second, x, y + th + gaps, w, bh);
-    }
+    if (c->hidden == COVER_UNMAP)
+        XMapWindow(dpy, c->win);
+    else if (how == COVER_UNMAP)
+        XUnmapWindow(dpy, c->win);
+    if ((c->hidden == COVER_SHOW) != (how == COVER_SHOW))
+        window_set_ewmh_state(c->win, atoms[ATOM_NET_WM_STATE_HIDDEN],
+                              how != COVER_SHOW);
+    c->hidden = how;
 }
 
+/* relays out every monitor, unchanged windows cost no requests */
 void tile(void) {
+    TRACE_SCOPE("layout", "tile");
     update_struts();
-    client_t *head = workspaces[current_ws];
+    for (int m = 0; m < n_monitors; m++)
+        tile_ws(monitors[m].ws);
+}
+
+/* lays out ws on its monitor with the struts from the last update_struts() */
+void tile_ws(int ws) {
+    client_t *head = workspaces[ws];
 
     client_t *tileable[MAX_CLIENTS] = {0};
     int n_tileable = 0;
@@ -1898,45 +2378,73 @@ void tile(void) {
     if (n_tileable == 0)
         return;
 
+    /* nothing tiled shows past a fullscreen window, so nothing is laid out
+     * until it goes. the covered windows are hidden as fullscreen_hide
+     * says */
+    if (ws_fullscreen(ws)) {
+        int how = CLAMP(user_config.fullscreen_hide, COVER_SHOW, COVER_UNMAP);
+        for (client_t *c = head; c; c = c->next)
+            cover_client(c, !c->mapped || c->floating || c->fullscreen
+                                ? COVER_SHOW
+                                : how);
+        return;
+    }
+
+    monitor_t *mon = &monitors[ws_mon[ws]];
     int gaps = user_config.gaps;
-    int x = reserve_left + gaps;
-    int y = reserve_top + gaps;
-    int w = MAX(1, scr_width - reserve_left - reserve_right - 2 * gaps);
-    int h = MAX(1, scr_height - reserve_top - reserve_bottom - 2 * gaps);
+    int x = mon->x + mon->reserve_left + gaps;
+    int y = mon->y + mon->reserve_top + gaps;
+    int w = MAX(1, mon->w - mon->reserve_left - mon->reserve_right - 2 * gaps);
+    int h = MAX(1, mon->h - mon->reserve_top - mon->reserve_bottom - 2 * gaps);
 
     if (monocle) {
-        for (int i = 0; i < n_tileable; i++) {
-            client_t *c = tileable[i];
-            int bw = user_config.border_width;
-            XWindowChanges wc = {.x = x,
-                                 .y = y,
-                                 .width = MAX(1, w - 2 * bw),
-                                 .height = MAX(1, h - 2 * bw),
-                                 .border_width = bw};
-            XConfigureWindow(dpy, c->win,
-                             CWX | CWY | CWWidth | CWHeight | CWBorderWidth,
-                             &wc);
-            c->x = wc.x;
-            c->y = wc.y;
-            c->w = wc.width;
-            c->h = wc.height;
+        /* only the window on top is sized. the ones under it keep their
+         * tiled geometry, so going back to bsp moves nothing that did not
+         * change in the meantime */
+        client_t *top = ws_focused[ws];
+        if (!top || top->ws != ws || !top->mapped || top->floating ||
+            top->fullscreen) {
+            top = tileable[0];
+            for (int i = 0; i < n_tileable; i++) {
+                if (tileable[i]->hidden == COVER_SHOW) {
+                    top = tileable[i];
+                    break;
+                }
+            }
         }
-        if (focused && focused->mapped && !focused->floating &&
-            !focused->fullscreen)
-            XRaiseWindow(dpy, focused->win);
+        layout_monocle(&xlib_backend, &top, 1, x, y, w, h,
+                       user_config.border_width);
+        int how = CLAMP(user_config.monocle_hide, COVER_SHOW, COVER_UNMAP);
+        for (client_t *c = head; c; c = c->next)
+            cover_client(c, c == top || !c->mapped || c->floating ||
+                                    c->fullscreen
+                                ? COVER_SHOW
+                                : how);
+
+        Bool new_top = top->win != monocle_top[ws];
+        monocle_top[ws] = top->win;
+        if (ws != current_ws)
+            return;
+        if (new_top || top == focused)
+            XRaiseWindow(dpy, top->win);
         update_borders();
         return;
     }
+    monocle_top[ws] = None;
+    for (client_t *c = head; c; c = c->next)
+        cover_client(c, COVER_SHOW);
 
-    bsp_node_t **bsp = &bsp_roots[current_ws];
+    bsp_node_t **bsp = &bsp_roots[ws];
 
     if (!*bsp) {
         for (int i = 0; i < n_tileable; i++)
             bsp_insert(bsp, i > 0 ? tileable[i - 1] : NULL, tileable[i]);
     }
 
-    bsp_assign_rects(*bsp, x, y, w, h);
-    update_borders();
+    bsp_assign_rects(&xlib_backend, *bsp, x, y, w, h, gaps,
+                     user_config.border_width);
+    if (ws == current_ws)
+        update_borders();
 }
 
 void toggle_floating(void) {
@@ -1945,6 +2453,7 @@ void toggle_floating(void) {
 
     if (focused->fullscreen) {
         focused->fullscreen = False;
+        set_bypass(focused, False);
         tile();
         XSetWindowBorderWidth(dpy, focused->win, user_config.border_width);
     }
@@ -1953,7 +2462,7 @@ void toggle_floating(void) {
 
     if (focused->floating) {
         /* Window is becoming floating: remove from BSP */
-        bsp_remove(&bsp_roots[current_ws], focused);
+        bsp_remove(&bsp_roots[focused->ws], focused);
         XWindowAttributes wa;
         if (XGetWindowAttributes(dpy, focused->win, &wa)) {
             focused->x = wa.x;
@@ -1968,7 +2477,7 @@ void toggle_floating(void) {
                                                .height = focused->h});
         }
     } else {
-        bsp_insert(&bsp_roots[current_ws], NULL, focused);
+        bsp_insert(&bsp_roots[focused->ws], NULL, focused);
     }
     tile();
     update_borders();
@@ -2018,6 +2527,7 @@ void toggle_fullscreen(void) {
 
 void toggle_monocle(void) {
     monocle = !monocle;
+    ipc_notify(IPC_EV_LAYOUT, None, monocle);
     tile();
     update_borders();
     if (focused)
@@ -2025,10 +2535,11 @@ void toggle_monocle(void) {
 }
 
 void update_borders(void) {
-    for (client_t *c = workspaces[current_ws]; c; c = c->next)
-        XSetWindowBorder(dpy, c->win,
-                         (c == focused ? user_config.border_foc_col
-                                       : user_config.border_ufoc_col));
+    for (int m = 0; m < n_monitors; m++)
+        for (client_t *c = workspaces[monitors[m].ws]; c; c = c->next)
+            XSetWindowBorder(dpy, c->win,
+                             (c == focused ? user_config.border_foc_col
+                                           : user_config.border_ufoc_col));
 
     if (focused) {
         Window w = focused->win;
@@ -2069,6 +2580,56 @@ void update_modifier_masks(void) {
     XFreeModifiermap(mod_mapping);
 }
 
+/* outputs came, went or changed size. only the visible workspaces whose
+ * monitor changed are relaid out now, hidden ones wait until they are shown
+ * again */
+void update_monitors(void) {
+    Bool was_visible[NUM_WORKSPACES];
+    for (int ws = 0; ws < NUM_WORKSPACES; ws++)
+        was_visible[ws] = ws_visible(ws);
+
+    int changed = monitor_update();
+    /* the focused workspace stays on screen, wherever it ended up */
+    if (!ws_visible(current_ws))
+        monitor_show(ws_mon[current_ws], current_ws);
+    Bool same = !changed;
+    for (int ws = 0; ws < NUM_WORKSPACES && same; ws++)
+        same = was_visible[ws] == ws_visible(ws);
+    if (same)
+        return;
+    stale_ws |= changed;
+
+    int relayout = 0;
+    XGrabServer(dpy);
+    for (int ws = 0; ws < NUM_WORKSPACES; ws++) {
+        if (!ws_visible(ws)) {
+            if (was_visible[ws])
+                for (client_t *c = workspaces[ws]; c; c = c->next)
+                    if (c->mapped)
+                        XUnmapWindow(dpy, c->win);
+            continue;
+        }
+        if (!was_visible[ws])
+            for (client_t *c = workspaces[ws]; c; c = c->next)
+                if (c->mapped && c->hidden != COVER_UNMAP)
+                    XMapWindow(dpy, c->win);
+        if (!was_visible[ws] || stale_ws & 1 << ws) {
+            relayout |= 1 << ws;
+            refit_ws(ws);
+        }
+    }
+
+    if (relayout) {
+        update_struts();
+        for (int ws = 0; ws < NUM_WORKSPACES; ws++)
+            if (relayout & 1 << ws)
+                tile_ws(ws);
+        update_borders();
+    }
+    XUngrabServer(dpy);
+    XSync(dpy, False);
+}
+
 void update_net_client_list(void) {
     Window wins[MAX_CLIENTS];
     int n = 0;
@@ -2080,11 +2641,20 @@ void update_net_client_list(void) {
                     PropModeReplace, (unsigned char *)wins, n);
 }
 
+/* the monitor a strut's inner edge sits on, -1 if it sits on none */
+static monitor_t *strut_monitor(int x, int y) {
+    int m = monitor_at(x, y);
+    return m >= 0 ? &monitors[m] : NULL;
+}
+
 void update_struts(void) {
-    reserve_left = 0;
-    reserve_right = 0;
-    reserve_top = 0;
-    reserve_bottom = 0;
+    TRACE_SCOPE("layout", "update_struts");
+    for (int m = 0; m < n_monitors; m++) {
+        monitors[m].reserve_left = 0;
+        monitors[m].reserve_right = 0;
+        monitors[m].reserve_top = 0;
+        monitors[m].reserve_bottom = 0;
+    }
 
     Window root_ret;
     Window parent_ret;
@@ -2094,9 +2664,6 @@ void update_struts(void) {
     if (!XQueryTree(dpy, root, &root_ret, &parent_ret, &children, &n_children))
         return;
 
-    int screen_w = scr_width;
-    int screen_h = scr_height;
-
     for (unsigned int i = 0; i < n_children; i++) {
         Window w = children[i];
 
@@ -2132,7 +2699,12 @@ void update_struts(void) {
         if (XGetWindowProperty(dpy, w, atoms[ATOM_NET_WM_STRUT_PARTIAL], 0, 12,
                                False, XA_CARDINAL, &actual, &sfmt, &len, &rem,
                                (unsigned char **)&str) == Success &&
-            str && len >= 12) {
+            str && len < 12) {
+            XFree(str);
+            str = NULL;
+        }
+
+        if (str) {
 
             /*
              ewmh:
@@ -2143,20 +2715,17 @@ void update_struts(void) {
              [8] top_start_x,    [9] top_end_x
              [10] bottom_start_x,[11] bottom_end_x
 
-             all coords are in root space.
+             all coords are in root space, measured from the root window's
+             edges. a strut counts against the monitor its inner edge is on.
              */
             long left = str[0];
             long right = str[1];
             long top = str[2];
             long bottom = str[3];
-            long left_start_y = str[4];
-            long left_end_y = str[5];
-            long right_start_y = str[6];
-            long right_end_y = str[7];
-            long top_start_x = str[8];
-            long top_end_x = str[9];
-            long bot_start_x = str[10];
-            long bot_end_x = str[11];
+            int left_y = (int)((str[4] + str[5]) / 2);
+            int right_y = (int)((str[6] + str[7]) / 2);
+            int top_x = (int)((str[8] + str[9]) / 2);
+            int bot_x = (int)((str[10] + str[11]) / 2);
 
             XFree(str);
 
@@ -2164,48 +2733,30 @@ void update_struts(void) {
             if (!left && !right && !top && !bottom)
                 continue;
 
-            if (left > 0) {
-                long span_start = left_start_y;
-                long span_end = left_end_y;
-                if (span_end >= 0 && span_start <= scr_height - 1) {
-                    int reserve = (int)MAX(0, left);
-                    if (reserve > 0)
-                        reserve_left = MAX(reserve_left, reserve);
-                }
+            monitor_t *mon;
+            if (left > 0 && (mon = strut_monitor((int)left - 1, left_y))) {
+                int reserve = CLAMP((int)left - mon->x, 0, mon->w - 1);
+                mon->reserve_left = MAX(mon->reserve_left, reserve);
             }
 
-            if (right > 0) {
-                long span_start = right_start_y;
-                long span_end = right_end_y;
-                if (span_end >= 0 && span_start <= scr_height - 1) {
-                    int global_reserved_left = screen_w - (int)right;
-                    int overlap = scr_width - global_reserved_left;
-                    int reserve = MAX(0, overlap);
-                    if (reserve > 0)
-                        reserve_right = MAX(reserve_right, reserve);
-                }
+            if (right > 0 &&
+                (mon = strut_monitor(scr_width - (int)right, right_y))) {
+                int reserve = CLAMP(mon->x + mon->w - (scr_width - (int)right),
+                                    0, mon->w - 1);
+                mon->reserve_right = MAX(mon->reserve_right, reserve);
             }
 
-            if (top > 0) {
-                long span_start = top_start_x;
-                long span_end = top_end_x;
-                if (span_end >= 0 && span_start <= scr_width - 1) {
-                    int reserve = (int)MAX(0, top);
-                    if (reserve > 0)
-                        reserve_top = MAX(reserve_top, reserve);
-                }
+            if (top > 0 && (mon = strut_monitor(top_x, (int)top - 1))) {
+                int reserve = CLAMP((int)top - mon->y, 0, mon->h - 1);
+                mon->reserve_top = MAX(mon->reserve_top, reserve);
             }
 
-            if (bottom > 0) {
-                long span_start = bot_start_x;
-                long span_end = bot_end_x;
-                if (span_end >= 0 && span_start <= scr_width - 1) {
-                    int global_reserved_top = screen_h - (int)bottom;
-                    int overlap = scr_height - global_reserved_top;
-                    int reserve = MAX(0, overlap);
-                    if (reserve > 0)
-                        reserve_bottom = MAX(reserve_bottom, reserve);
-                }
+            if (bottom > 0 &&
+                (mon = strut_monitor(bot_x, scr_height - (int)bottom))) {
+                int reserve =
+                    CLAMP(mon->y + mon->h - (scr_height - (int)bottom), 0,
+                          mon->h - 1);
+                mon->reserve_bottom = MAX(mon->reserve_bottom, reserve);
             }
         }
     }
@@ -2216,16 +2767,22 @@ void update_struts(void) {
     update_workarea();
 }
 
+/* one rect per desktop, the free part of the monitor it belongs to */
 void update_workarea(void) {
-    long workarea[4];
+    long workarea[NUM_WORKSPACES * 4];
 
-    workarea[0] = reserve_left;
-    workarea[1] = reserve_top;
-    workarea[2] = scr_width - reserve_left - reserve_right;
-    workarea[3] = scr_height - reserve_top - reserve_bottom;
+    for (int ws = 0; ws < NUM_WORKSPACES; ws++) {
+        monitor_t *mon = &monitors[ws_mon[ws]];
+        long *wa = &workarea[ws * 4];
+        wa[0] = mon->x + mon->reserve_left;
+        wa[1] = mon->y + mon->reserve_top;
+        wa[2] = mon->w - mon->reserve_left - mon->reserve_right;
+        wa[3] = mon->h - mon->reserve_top - mon->reserve_bottom;
+    }
 
     XChangeProperty(dpy, root, atoms[ATOM_NET_WORKAREA], XA_CARDINAL, 32,
-                    PropModeReplace, (unsigned char *)workarea, 4);
+                    PropModeReplace, (unsigned char *)workarea,
+                    NUM_WORKSPACES * 4);
 }
 
 void warp_cursor(client_t *c) {
@@ -2282,7 +2839,7 @@ void window_set_ewmh_state(Window w, Atom state, Bool add) {
     unsigned long list_len = 0;
 
     if (found_atoms) {
-        for (unsigned long i = 0; i < n_atoms; i++) {
+        for (unsigned long i = 0; i < n_atoms && list_len < 16; i++) {
             if (found_atoms[i] != state)
                 list[list_len++] = found_atoms[i];
         }
@@ -2323,25 +2880,49 @@ int xerr(Display *d, XErrorEvent *ee) {
 }
 
 void xev_case(XEvent *xev) {
-    if (xev->type >= 0 && xev->type < LASTEvent)
+    if (xev->type >= 0 && xev->type < LASTEvent) {
+        TRACE_SCOPE("xev_case",
+                    event_names[xev->type] ? event_names[xev->type] : "?");
+        record_event(xev);
+        STATS_BEGIN();
         evtable[xev->type](xev);
-    else
+        STATS_END(xev->type);
+    } else if (monitor_event(xev)) {
+        TRACE_SCOPE("xev_case", "RRScreenChangeNotify");
+        record_screens();
+        update_monitors();
+    } else
         fprintf(stderr, "tilite: invalid event type: %d\n", xev->type);
 }
 
+#ifndef TILITE_REPLAY
 int main(int ac, char **av) {
-    if (ac > 1) {
+    const char *record_path = NULL;
+
+    self_path = av[0];
+    if (ac == 3 && strcmp(av[1], "-r") == 0) {
+        record_path = av[2];
+    } else if (ac == 3 && strcmp(av[1], "-R") == 0) {
+        restore_fd = atoi(av[2]);
+    } else if (ac > 1) {
         if (strcmp(av[1], "-v") == 0 || strcmp(av[1], "--version") == 0) {
             printf("%s\n%s\n%s\n", VERSION, AUTHOR, LICENSE);
             return EXIT_SUCCESS;
         } else {
             printf("usage:\n");
             printf("\t[-v || --version]: See the version of tilite\n");
+            printf("\t[-r file]: Record an event trace for tilite-replay\n");
             return EXIT_SUCCESS;
         }
     }
     setup();
+    if (record_path && record_open(record_path) < 0)
+        fprintf(stderr, "tilite: cannot record to %s\n", record_path);
     puts("tilite: starting...");
+    /* a restart keeps the session that is already running */
+    if (restore_fd < 0)
+        autostart();
     run();
     return EXIT_SUCCESS;
 }
+#endif
@@ -0,0 +1,98 @@
+#ifdef TILITE_TRACE
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <X11/Xlib.h>
+
+#include "defs.h"
+#include "trace.h"
+
+#define TRACE_RING_SIZE 65536 /* power of two */
+
+typedef struct {
+    const char *cat;
+    const char *name;
+    uint64_t start;
+    uint64_t dur;
+} trace_rec_t;
+
+/* single writer, the event loop. head only ever grows, readers take a copy of
+ * it and read the last TRACE_RING_SIZE records behind it. */
+static trace_rec_t ring[TRACE_RING_SIZE];
+static uint64_t head = 0;
+static volatile sig_atomic_t dump_requested = 0;
+
+static void trace_sig(int sig) {
+    (void)sig;
+    dump_requested = 1;
+}
+
+int trace_dump(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f)
+        return -1;
+
+    uint64_t end = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+    uint64_t begin = end > TRACE_RING_SIZE ? end - TRACE_RING_SIZE : 0;
+    long pid = (long)getpid();
+
+    fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(f,
+            "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%ld,\"tid\":%ld,"
+            "\"args\":{\"name\":\"tilite\"}}",
+            pid, pid);
+
+    for (uint64_t i = begin; i < end; i++) {
+        trace_rec_t *r = &ring[i & (TRACE_RING_SIZE - 1)];
+        fprintf(f,
+                ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+                "\"ts\":%.3f,\"dur\":%.3f,\"pid\":%ld,\"tid\":%ld}",
+                r->name, r->cat, r->start / 1e3, r->dur / 1e3, pid, pid);
+    }
+
+    fprintf(f, "\n]}\n");
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+void trace_init(void) { signal(SIGUSR2, trace_sig); }
+
+uint64_t trace_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+void trace_poll(void) {
+    if (!dump_requested)
+        return;
+    dump_requested = 0;
+
+    const char *path = getenv("TILITE_TRACE_FILE");
+    if (!path || !*path)
+        path = "/tmp/tilite-trace.json";
+
+    if (trace_dump(path) < 0)
+        perror("tilite: trace dump");
+    else
+        fprintf(stderr, "tilite: trace written to %s\n", path);
+}
+
+void trace_scope_end(trace_scope_t *scope) {
+    uint64_t now = trace_now();
+    uint64_t h = __atomic_load_n(&head, __ATOMIC_RELAXED);
+
+    ring[h & (TRACE_RING_SIZE - 1)] = (trace_rec_t){
+        .cat = scope->cat,
+        .name = scope->name,
+        .start = scope->start,
+        .dur = now - scope->start,
+    };
+    __atomic_store_n(&head, h + 1, __ATOMIC_RELEASE);
+}
+#else
+typedef int trace_disabled_t;
+#endif
@@ -0,0 +1,35 @@
+#pragma once
+
+/* chrome trace / perfetto timelines, built with -DTILITE_TRACE (see Makefile).
+ * TRACE_SCOPE() times the rest of the enclosing block and records it into a
+ * fixed ring buffer when the block exits. without the flag the hooks expand
+ * to nothing. */
+
+#ifdef TILITE_TRACE
+#include <stdint.h>
+#include <stdio.h>
+
+typedef struct {
+    const char *cat;
+    const char *name;
+    uint64_t start;
+} trace_scope_t;
+
+int trace_dump(const char *path);
+void trace_init(void);
+uint64_t trace_now(void);
+void trace_poll(void);
+void trace_scope_end(trace_scope_t *scope);
+
+#define TRACE_CAT_(a, b) a##b
+#define TRACE_CAT(a, b) TRACE_CAT_(a, b)
+#define TRACE_SCOPE(cat, name)                                                 \
+    trace_scope_t TRACE_CAT(trace_scope_, __LINE__)                            \
+        __attribute__((cleanup(trace_scope_end))) = {cat, name, trace_now()}
+#define TRACE_INIT() trace_init()
+#define TRACE_POLL() trace_poll()
+#else
+#define TRACE_SCOPE(cat, name)
+#define TRACE_INIT()
+#define TRACE_POLL()
+#endif
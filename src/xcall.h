@@ -0,0 +1,32 @@
+#pragma once
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+#include "stats.h"
+#include "trace.h"
+
+/* Xlib calls that block on a reply from the server. when stats or tracing is
+ * built in they are wrapped so round trips are counted and timed, otherwise
+ * they are left alone. */
+#if defined(TILITE_STATS) || defined(TILITE_TRACE)
+#define XCALL(fn, ...)                                                         \
+    __extension__({                                                            \
+        STATS_ROUNDTRIP();                                                     \
+        TRACE_SCOPE("xlib", #fn);                                              \
+        fn(__VA_ARGS__);                                                       \
+    })
+
+#define XAllocColor(...) XCALL(XAllocColor, __VA_ARGS__)
+#define XGetClassHint(...) XCALL(XGetClassHint, __VA_ARGS__)
+#define XGetModifierMapping(...) XCALL(XGetModifierMapping, __VA_ARGS__)
+#define XGetTransientForHint(...) XCALL(XGetTransientForHint, __VA_ARGS__)
+#define XGetWMNormalHints(...) XCALL(XGetWMNormalHints, __VA_ARGS__)
+#define XGetWMProtocols(...) XCALL(XGetWMProtocols, __VA_ARGS__)
+#define XGetWindowAttributes(...) XCALL(XGetWindowAttributes, __VA_ARGS__)
+#define XGetWindowProperty(...) XCALL(XGetWindowProperty, __VA_ARGS__)
+#define XGrabPointer(...) XCALL(XGrabPointer, __VA_ARGS__)
+#define XInternAtom(...) XCALL(XInternAtom, __VA_ARGS__)
+#define XQueryPointer(...) XCALL(XQueryPointer, __VA_ARGS__)
+#define XQueryTree(...) XCALL(XQueryTree, __VA_ARGS__)
+#define XSync(...) XCALL(XSync, __VA_ARGS__)
+#endif